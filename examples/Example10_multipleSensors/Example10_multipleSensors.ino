@@ -0,0 +1,84 @@
+/*!
+ * @file Example10_multipleSensors.ino
+ *
+ * This example was written by:
+ * SparkFun Electronics
+ * October 14th 2026
+ * 
+ * This example demonstrates how to read many VEML7700s connected through a TCA9548A I2C mux.
+ * The VEML7700 I2C address is fixed, so each sensor needs its own mux channel.
+ * All of the integrations are started together, so reading every sensor takes about
+ * one integration time - not one per sensor. Each mux channel is selected only once per sweep.
+ * 
+ * Want to support open source hardware? Buy a board from SparkFun!
+ * <br>SparkX smôl Environmental Peripheral Board (SPX-18976): https://www.sparkfun.com/products/18976
+ * 
+ * Please see LICENSE.md for the license information
+ * 
+ */
+
+#include <SparkFun_VEML7700_Arduino_Library.h> // Click here to get the library: http://librarymanager/All#SparkFun_VEML7700
+
+#define MUX_ADDRESS 0x70 // The default TCA9548A address
+#define NUM_SENSORS 4 // The number of VEML7700s. Connect them to mux channels 0 to NUM_SENSORS - 1
+
+// The mux select callback. The array calls this each time it needs to change channel.
+bool selectMuxChannel(uint8_t channel, void *context)
+{
+  Wire.beginTransmission(MUX_ADDRESS);
+  Wire.write(1 << channel);
+  return (Wire.endTransmission() == 0);
+}
+
+VEML7700Array<NUM_SENSORS> mySensors(selectMuxChannel); // Create an array of VEML7700s
+
+float lux[NUM_SENSORS]; // Storage for the lux readings
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println(F("SparkFun VEML7700 Example"));
+
+  Wire.begin();
+
+  // Tell the array which mux channel each sensor is connected to
+  for (uint8_t i = 0; i < NUM_SENSORS; i++)
+    mySensors.addSensor(i);
+
+  // Begin all of the VEML7700s using the Wire I2C port
+  // .begin will return true on success, or false on failure to communicate
+  if (mySensors.begin() == false)
+  {
+    Serial.println("Unable to communicate with all of the VEML7700s. Please check the wiring. Freezing...");
+    while (1)
+      ;
+  }
+
+  // Change the settings of all the sensors, with a single write to each
+  VEML7700_config_t config;
+  config.shutdown = VEML7700_POWER_ON;
+  config.interruptEnable = VEML7700_INT_DISABLE;
+  config.persistenceProtect = VEML7700_PERSISTENCE_1;
+  config.integrationTime = VEML7700_INTEGRATION_100ms;
+  config.sensitivityMode = VEML7700_SENSITIVITY_x1;
+  mySensors.applyConfiguration(config);
+
+  mySensors.startSweep(); // Start all of the integrations together
+}
+
+void loop()
+{
+  if (mySensors.isSweepReady()) // Check if all of the sensors have a new reading. This does not use I2C.
+  {
+    mySensors.readSweep(lux); // Read all of the sensors
+
+    for (uint8_t i = 0; i < NUM_SENSORS; i++)
+    {
+      Serial.print(lux[i], 4);
+      Serial.print(F("\t"));
+    }
+    Serial.println();
+  }
+
+  // Do other things here!
+}
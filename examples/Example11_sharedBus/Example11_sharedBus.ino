@@ -0,0 +1,104 @@
+/*!
+ * @file Example11_sharedBus.ino
+ *
+ * This example was written by:
+ * SparkFun Electronics
+ * October 14th 2026
+ * 
+ * This example demonstrates how to share the I2C bus safely between FreeRTOS tasks.
+ * setBusLock tells the library to take a mutex around each register transaction,
+ * so another task can not use the bus between the command code and the data read.
+ * Other tasks using the same Wire port should take the same mutex.
+ * 
+ * This example needs an ESP32 (or another platform with FreeRTOS semaphores).
+ * 
+ * Want to support open source hardware? Buy a board from SparkFun!
+ * <br>SparkX smôl Environmental Peripheral Board (SPX-18976): https://www.sparkfun.com/products/18976
+ * 
+ * Please see LICENSE.md for the license information
+ * 
+ */
+
+#include <SparkFun_VEML7700_Arduino_Library.h> // Click here to get the library: http://librarymanager/All#SparkFun_VEML7700
+
+VEML7700 mySensor; // Create a VEML7700 object
+
+#if defined(ARDUINO_ARCH_ESP32)
+
+SemaphoreHandle_t i2cMutex; // The mutex shared by everything using Wire
+
+bool acquireBus(void *context)
+{
+  // Wait up to 100ms for the bus. If we time out, the library returns VEML7700_ERROR_BUSY
+  return (xSemaphoreTake((SemaphoreHandle_t)context, pdMS_TO_TICKS(100)) == pdTRUE);
+}
+
+void releaseBus(void *context)
+{
+  xSemaphoreGive((SemaphoreHandle_t)context);
+}
+
+void luxTask(void *parameter)
+{
+  while (1)
+  {
+    float lux;
+    if (mySensor.getLux(&lux) == VEML7700_SUCCESS)
+    {
+      Serial.print(F("Lux: "));
+      Serial.println(lux, 4);
+    }
+    vTaskDelay(pdMS_TO_TICKS(250));
+  }
+}
+
+#endif
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println(F("SparkFun VEML7700 Example"));
+
+#if defined(ARDUINO_ARCH_ESP32)
+
+  Wire.begin();
+
+  i2cMutex = xSemaphoreCreateMutex();
+
+  // Take the mutex around each VEML7700 register transaction
+  mySensor.setBusLock(acquireBus, releaseBus, (void *)i2cMutex);
+
+  //mySensor.enableDebugging(); // Uncomment this line to enable helpful debug messages on Serial
+
+  // Begin the VEML7700 using the Wire I2C port
+  // .begin will return true on success, or false on failure to communicate
+  if (mySensor.begin() == false)
+  {
+    Serial.println("Unable to communicate with the VEML7700. Please check the wiring. Freezing...");
+    while (1)
+      ;
+  }
+
+  // Read the VEML7700 from its own task. Other tasks can share Wire by taking i2cMutex too
+  xTaskCreate(luxTask, "luxTask", 4096, NULL, 1, NULL);
+
+#else
+
+  Serial.println(F("This example needs FreeRTOS. Please try it on an ESP32"));
+
+#endif
+}
+
+void loop()
+{
+#if defined(ARDUINO_ARCH_ESP32)
+  // Another device on the same bus. Take the mutex around its transactions too
+  if (xSemaphoreTake(i2cMutex, pdMS_TO_TICKS(100)) == pdTRUE)
+  {
+    Wire.beginTransmission(0x42); // Check if something else is connected
+    Wire.endTransmission();
+    xSemaphoreGive(i2cMutex);
+  }
+#endif
+  delay(1000);
+}
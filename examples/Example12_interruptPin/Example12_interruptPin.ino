@@ -0,0 +1,95 @@
+/*!
+ * @file Example12_interruptPin.ino
+ *
+ * This example was written by:
+ * SparkFun Electronics
+ * October 14th 2026
+ * 
+ * This example demonstrates how to use the sensor's INT pin to detect threshold crossings,
+ * instead of polling the interrupt status (like Example3 does).
+ * service only reads the interrupt status when the INT pin has gone low, so there is no
+ * I2C traffic at all between threshold crossings.
+ * 
+ * Note: the VEML7700 itself does not have an INT pin. This example is for boards which use a
+ * pin-compatible sensor (e.g. the VEML6030) with INT connected to a GPIO.
+ * 
+ * Want to support open source hardware? Buy a board from SparkFun!
+ * <br>SparkX smôl Environmental Peripheral Board (SPX-18976): https://www.sparkfun.com/products/18976
+ * 
+ * Please see LICENSE.md for the license information
+ * 
+ */
+
+#include <SparkFun_VEML7700_Arduino_Library.h> // Click here to get the library: http://librarymanager/All#SparkFun_VEML7700
+
+VEML7700 mySensor; // Create a VEML7700 object
+
+const uint8_t interruptPin = 2; // Change this to match the GPIO connected to INT
+
+void highThresholdExceeded(void *context)
+{
+  Serial.println(F("High Threshold Exceeded"));
+}
+
+void lowThresholdExceeded(void *context)
+{
+  Serial.println(F("Low Threshold Exceeded"));
+}
+
+void luxChanged(uint16_t ambient, float lux, void *context)
+{
+  Serial.print(F("Lux changed to: "));
+  Serial.println(lux, 4);
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println(F("SparkFun VEML7700 Example"));
+
+  Wire.begin();
+
+  //mySensor.enableDebugging(); // Uncomment this line to enable helpful debug messages on Serial
+
+  // Begin the VEML7700 using the Wire I2C port
+  // .begin will return true on success, or false on failure to communicate
+  if (mySensor.begin() == false)
+  {
+    Serial.println("Unable to communicate with the VEML7700. Please check the wiring. Freezing...");
+    while (1)
+      ;
+  }
+
+  //Let's change the high threshold to 30000 counts and the low threshold to 1000 counts
+  mySensor.setHighThreshold(30000);
+  mySensor.setLowThreshold(1000);
+
+  //Tell the library which functions to call when the thresholds are exceeded
+  mySensor.setHighThresholdCallback(highThresholdExceeded);
+  mySensor.setLowThresholdCallback(lowThresholdExceeded);
+
+  //Attach the interrupt
+  if (mySensor.attachInterruptPin(interruptPin) != VEML7700_SUCCESS)
+  {
+    Serial.println(F("That pin does not support interrupts. Freezing..."));
+    while (1)
+      ;
+  }
+
+  //Enable the high and low threshold interrupts
+  mySensor.setInterruptEnable(VEML7700_INT_ENABLE);
+
+  //Or, uncomment these lines to use window tracking instead. The window is re-centred on each new reading,
+  //so the callback is only called when the lux changes by more than 10% (for 4 consecutive conversions)
+  //mySensor.setWindowChangeCallback(luxChanged);
+  //mySensor.enableWindowTracking(10, VEML7700_PERSISTENCE_4);
+}
+
+void loop()
+{
+  // service returns immediately unless INT has signalled an event.
+  // When it has, service reads the interrupt status and calls the callbacks
+  mySensor.service();
+
+  // loop is free to do other things here
+}
@@ -0,0 +1,83 @@
+/*!
+ * @file Example13_sampleBuffer.ino
+ *
+ * This example was written by:
+ * SparkFun Electronics
+ * October 14th 2026
+ * 
+ * This example demonstrates how to buffer the readings and process them in batches.
+ * Each poll reading is stored in a ring buffer as a compact 4-byte sample.
+ * Every ten seconds, the whole batch is drained and converted to lux in one go.
+ * 
+ * Want to support open source hardware? Buy a board from SparkFun!
+ * <br>SparkX smôl Environmental Peripheral Board (SPX-18976): https://www.sparkfun.com/products/18976
+ * 
+ * Please see LICENSE.md for the license information
+ * 
+ */
+
+#include <SparkFun_VEML7700_Arduino_Library.h> // Click here to get the library: http://librarymanager/All#SparkFun_VEML7700
+
+VEML7700 mySensor; // Create a VEML7700 object
+
+#define BATCH_SIZE 100
+
+VEML7700SampleBuffer<BATCH_SIZE> myBuffer; // Create a buffer for 100 samples (400 bytes)
+
+unsigned long lastDrain;
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println(F("SparkFun VEML7700 Example"));
+
+  Wire.begin();
+
+  //mySensor.enableDebugging(); // Uncomment this line to enable helpful debug messages on Serial
+
+  // Begin the VEML7700 using the Wire I2C port
+  // .begin will return true on success, or false on failure to communicate
+  if (mySensor.begin() == false)
+  {
+    Serial.println("Unable to communicate with the VEML7700. Please check the wiring. Freezing...");
+    while (1)
+      ;
+  }
+
+  mySensor.enableConfigurationCache(); // Each poll will then only need to read the ALS_OUTPUT
+
+  mySensor.setSampleBuffer(&myBuffer); // Store each poll reading in myBuffer
+
+  mySensor.startMeasurement(); // Start the measurements
+
+  lastDrain = millis();
+}
+
+void loop()
+{
+  float lux;
+
+  // poll stores each fresh reading in myBuffer. We do not need to do anything with lux here
+  mySensor.poll(&lux);
+
+  if (millis() - lastDrain >= 10000) // Every ten seconds
+  {
+    lastDrain = millis();
+
+    static float luxBatch[BATCH_SIZE];
+    static unsigned long timestamps[BATCH_SIZE];
+
+    // Convert the whole batch into lux, oldest first
+    uint16_t numSamples = myBuffer.drain(luxBatch, BATCH_SIZE, timestamps);
+
+    Serial.print(numSamples);
+    Serial.println(F(" samples:"));
+
+    for (uint16_t i = 0; i < numSamples; i++)
+    {
+      Serial.print(timestamps[i]);
+      Serial.print(F("ms\t"));
+      Serial.println(luxBatch[i], 4);
+    }
+  }
+}
@@ -0,0 +1,81 @@
+/*!
+ * @file Example14_statistics.ino
+ *
+ * This example was written by:
+ * SparkFun Electronics
+ * October 14th 2026
+ * 
+ * This example demonstrates the streaming statistics.
+ * Each poll reading is added to a VEML7700Statistics, which keeps the running mean, variance,
+ * min and max, an exponential moving average, and a decimated (block averaged) output.
+ * Each sample takes constant time and no extra RAM, so this can run at the fastest (25ms) rate.
+ * 
+ * Want to support open source hardware? Buy a board from SparkFun!
+ * <br>SparkX smôl Environmental Peripheral Board (SPX-18976): https://www.sparkfun.com/products/18976
+ * 
+ * Please see LICENSE.md for the license information
+ * 
+ */
+
+#include <SparkFun_VEML7700_Arduino_Library.h> // Click here to get the library: http://librarymanager/All#SparkFun_VEML7700
+
+VEML7700 mySensor; // Create a VEML7700 object
+
+VEML7700Statistics myStats; // Create the statistics
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println(F("SparkFun VEML7700 Example"));
+
+  Wire.begin();
+
+  //mySensor.enableDebugging(); // Uncomment this line to enable helpful debug messages on Serial
+
+  // Begin the VEML7700 using the Wire I2C port
+  // .begin will return true on success, or false on failure to communicate
+  if (mySensor.begin() == false)
+  {
+    Serial.println("Unable to communicate with the VEML7700. Please check the wiring. Freezing...");
+    while (1)
+      ;
+  }
+
+  mySensor.enableConfigurationCache(); // Each poll will then only need to read the ALS_OUTPUT
+
+  mySensor.setIntegrationTime(VEML7700_INTEGRATION_25ms); // Let's sample as fast as possible
+
+  myStats.setEMAShift(4); // The EMA time constant is approximately 2^4 = 16 samples
+  myStats.setDecimation(40); // Average each block of 40 samples (approximately one second)
+
+  mySensor.setStatistics(&myStats); // Add each poll reading to myStats
+
+  mySensor.startMeasurement(); // Start the measurements
+}
+
+void loop()
+{
+  float lux;
+
+  // poll adds each fresh reading to myStats
+  mySensor.poll(&lux);
+
+  // Print the statistics each time a block of 40 samples is complete
+  if (myStats.getDecimatedLux(&lux) == VEML7700_SUCCESS)
+  {
+    Serial.print(F("Block mean: "));
+    Serial.print(lux, 4);
+    Serial.print(F("\tEMA: "));
+    Serial.print(myStats.getEMALux(), 4);
+    Serial.print(F("\tMean: "));
+    Serial.print(myStats.getMeanLux(), 4);
+    Serial.print(F("\tStd Dev: "));
+    Serial.print(myStats.getStdDevLux(), 4);
+    Serial.print(F("\tMin: "));
+    Serial.print(myStats.getMinLux(), 4);
+    Serial.print(F("\tMax: "));
+    Serial.println(myStats.getMaxLux(), 4);
+
+    myStats.reset(); // Start a fresh mean, variance, min and max
+  }
+}
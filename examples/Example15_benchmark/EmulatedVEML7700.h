@@ -0,0 +1,115 @@
+/*!
+ * @file EmulatedVEML7700.h
+ *
+ * Part of Example15_benchmark. Also used by the host benchmark in extras/host.
+ *
+ * Emulates up to NUM_EMULATED_SENSORS VEML7700s behind a mux, as a custom VEML7700Transport.
+ * Each holds a register map and converts a simulated lux into the ALS count
+ * for the current gain and integration time. The I2C transactions and bytes are counted.
+ * 
+ * Please see LICENSE.md for the license information
+ * 
+ */
+
+#ifndef EMULATED_VEML7700_H
+#define EMULATED_VEML7700_H
+
+#include <SparkFun_VEML7700_Arduino_Library.h>
+
+#define NUM_EMULATED_SENSORS 4
+
+// Emulate up to NUM_EMULATED_SENSORS VEML7700s, one per mux channel
+class EmulatedVEML7700 : public VEML7700Transport
+{
+public:
+  EmulatedVEML7700()
+  {
+    for (uint8_t c = 0; c < NUM_EMULATED_SENSORS; c++)
+    {
+      for (uint8_t r = 0; r < 8; r++)
+        registers[c][r] = 0;
+      registers[c][0] = 0x0001; // Power-on default: shut down
+      lux[c] = 100.0;
+    }
+    channel = 0;
+    resetCounts();
+  }
+
+  VEML7700_error_t read(uint8_t address, uint8_t reg, uint8_t *dest, uint8_t len)
+  {
+    transactions++;
+    bytes += 1 + len; // The command code, then the data
+    if ((address != VEML7700_I2C_ADDRESS) || (reg > 6) || (len != 2))
+      return (VEML7700_ERROR_READ);
+
+    uint16_t value = registers[channel][reg];
+    if ((reg == 4) || (reg == 5)) // ALS and WHITE
+      value = counts(channel);
+    if (reg == 6) // Reading the interrupt status clears it
+      registers[channel][6] = 0;
+
+    dest[0] = value & 0xFF;
+    dest[1] = value >> 8;
+    return (VEML7700_ERROR_SUCCESS);
+  }
+
+  VEML7700_error_t write(uint8_t address, uint8_t reg, const uint8_t *src, uint8_t len)
+  {
+    transactions++;
+    bytes += 1 + len;
+    if ((address != VEML7700_I2C_ADDRESS) || (reg > 3) || (len != 2))
+      return (VEML7700_ERROR_WRITE);
+
+    registers[channel][reg] = ((uint16_t)src[1] << 8) | src[0];
+    return (VEML7700_ERROR_SUCCESS);
+  }
+
+  // The ALS count for the simulated lux, using the emulated gain and integration time
+  uint16_t counts(uint8_t c)
+  {
+    const uint8_t gainFactor[4] = { 2, 1, 16, 8 }; // x1, x2, x1/8, x1/4
+    uint8_t sm = (registers[c][0] >> 11) & 0x3;
+    uint8_t it;
+    switch ((registers[c][0] >> 6) & 0xF)
+    {
+      case 0b1100: it = 0; break; // 25ms
+      case 0b1000: it = 1; break;
+      case 0b0000: it = 2; break;
+      case 0b0001: it = 3; break;
+      case 0b0010: it = 4; break;
+      default: it = 5; break; // 800ms
+    }
+    float resolution = 0.0036 * gainFactor[sm] * (1 << (5 - it));
+    float count = lux[c] / resolution;
+    if (count >= 65535.0)
+      return (0xFFFF);
+    return ((uint16_t)count);
+  }
+
+  void resetCounts()
+  {
+    transactions = 0;
+    bytes = 0;
+    muxSelects = 0;
+  }
+
+  uint16_t registers[NUM_EMULATED_SENSORS][8];
+  float lux[NUM_EMULATED_SENSORS]; // The simulated lux for each sensor
+  uint8_t channel; // The selected mux channel
+  unsigned long transactions;
+  unsigned long bytes;
+  unsigned long muxSelects;
+};
+
+// The mux select callback for the VEML7700Array. context is the EmulatedVEML7700
+inline bool selectMuxChannel(uint8_t channel, void *context)
+{
+  EmulatedVEML7700 *e = (EmulatedVEML7700 *)context;
+  e->muxSelects++;
+  e->transactions++; // Count the mux write as a bus transaction too
+  e->bytes += 2; // Mux address + control byte
+  e->channel = channel;
+  return (true);
+}
+
+#endif
@@ -0,0 +1,148 @@
+/*!
+ * @file Example15_benchmark.ino
+ *
+ * This example was written by:
+ * SparkFun Electronics
+ * October 14th 2026
+ * 
+ * This example benchmarks the library's hot paths - without a sensor.
+ * The VEML7700s are emulated by a custom VEML7700Transport which holds their register maps,
+ * converts a simulated lux into the ALS count for the current gain and integration time,
+ * and counts the I2C transactions and bytes.
+ * For each API call, the bus transactions, bytes and time (micros) are printed.
+ * Use it to check changes to the library for regressions (e.g. extra configuration reads).
+ * 
+ * Note: the auto-range and sweep benchmarks wait for the (real) conversion times,
+ * so their times are mostly waiting. For the time spent in the library code alone,
+ * run the host benchmark in extras/host on a PC: there, delay() does not wait.
+ * 
+ * Want to support open source hardware? Buy a board from SparkFun!
+ * <br>SparkX smôl Environmental Peripheral Board (SPX-18976): https://www.sparkfun.com/products/18976
+ * 
+ * Please see LICENSE.md for the license information
+ * 
+ */
+
+#include <SparkFun_VEML7700_Arduino_Library.h> // Click here to get the library: http://librarymanager/All#SparkFun_VEML7700
+
+#include "EmulatedVEML7700.h" // The emulated sensors
+
+EmulatedVEML7700 emulator;
+
+VEML7700 mySensor; // Create a VEML7700 object
+
+VEML7700Array<NUM_EMULATED_SENSORS> mySensors(selectMuxChannel, &emulator);
+
+unsigned long startMicros;
+
+void startBenchmark()
+{
+  emulator.resetCounts();
+  startMicros = micros();
+}
+
+void endBenchmark(const char *name)
+{
+  unsigned long elapsed = micros() - startMicros;
+  Serial.print(name);
+  Serial.print(F(": transactions: "));
+  Serial.print(emulator.transactions);
+  Serial.print(F(" bytes: "));
+  Serial.print(emulator.bytes);
+  Serial.print(F(" time: "));
+  Serial.print(elapsed);
+  Serial.println(F("us"));
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println(F("SparkFun VEML7700 Example"));
+  Serial.println(F("Benchmarking with emulated sensors"));
+
+  emulator.channel = 0;
+
+  startBenchmark();
+  mySensor.begin(emulator); // Begin the VEML7700 using the emulator instead of Wire
+  endBenchmark("begin");
+
+  float lux;
+  uint32_t milliLux;
+  uint16_t ambient, white;
+
+  startBenchmark();
+  mySensor.getLux(&lux);
+  endBenchmark("getLux (uncached)");
+
+  startBenchmark();
+  mySensor.setIntegrationTime(VEML7700_INTEGRATION_200ms);
+  endBenchmark("setIntegrationTime (uncached)");
+
+  mySensor.enableConfigurationCache();
+  mySensor.syncConfiguration();
+
+  startBenchmark();
+  mySensor.getLux(&lux);
+  endBenchmark("getLux (cached)");
+
+  startBenchmark();
+  mySensor.getLuxMilli(&milliLux);
+  endBenchmark("getLuxMilli (cached)");
+
+  startBenchmark();
+  mySensor.getLuxCorrected(&lux);
+  endBenchmark("getLuxCorrected (cached)");
+
+  startBenchmark();
+  mySensor.setIntegrationTime(VEML7700_INTEGRATION_100ms);
+  endBenchmark("setIntegrationTime (cached)");
+
+  startBenchmark();
+  mySensor.getAmbientAndWhite(&ambient, &white);
+  endBenchmark("getAmbientAndWhite");
+
+  // Auto-range convergence: start at the least sensitive setting, in dim light
+  emulator.lux[0] = 5.0;
+  mySensor.setSensitivityMode(VEML7700_SENSITIVITY_x1_8);
+  mySensor.setIntegrationTime(VEML7700_INTEGRATION_25ms);
+
+  startBenchmark();
+  mySensor.getAutoRangedLux(&lux);
+  endBenchmark("getAutoRangedLux (dim, from x1/8 25ms)");
+  Serial.print(F("  conversions: "));
+  Serial.println(mySensor.getAutoRangeConversions());
+
+  // Now light that saturates the sensor
+  emulator.lux[0] = 50000.0;
+
+  startBenchmark();
+  mySensor.getAutoRangedLux(&lux);
+  endBenchmark("getAutoRangedLux (bright, saturated)");
+  Serial.print(F("  conversions: "));
+  Serial.println(mySensor.getAutoRangeConversions());
+
+  mySensor.shutdown();
+
+  // Multi-sensor sweep
+  for (uint8_t c = 0; c < NUM_EMULATED_SENSORS; c++)
+    mySensors.addSensor(c);
+
+  startBenchmark();
+  mySensors.begin(emulator);
+  endBenchmark("VEML7700Array begin");
+
+  float luxes[NUM_EMULATED_SENSORS];
+
+  mySensors.sweep(luxes); // The first sweep starts the measurements
+
+  startBenchmark();
+  mySensors.sweep(luxes);
+  endBenchmark("VEML7700Array sweep");
+  Serial.print(F("  mux selects: "));
+  Serial.println(emulator.muxSelects);
+}
+
+void loop()
+{
+  // Nothing to do here
+}
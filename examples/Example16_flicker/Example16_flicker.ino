@@ -0,0 +1,87 @@
+/*!
+ * @file Example16_flicker.ino
+ *
+ * This example was written by:
+ * SparkFun Electronics
+ * October 14th 2026
+ * 
+ * This example demonstrates the flicker analysis.
+ * measureFlicker reads a burst of evenly spaced 25ms conversions, then a VEML7700Flicker
+ * estimates the 50, 60, 100 and 120Hz modulation depth with a Goertzel filter per frequency.
+ * A healthy LED lamp should show very little flicker. A failing driver often shows strong 100Hz or 120Hz flicker.
+ * Some frequencies cannot be seen with the VEML7700's sample rate and integration time:
+ * these are reported as not observable.
+ * 
+ * Want to support open source hardware? Buy a board from SparkFun!
+ * <br>SparkX smôl Environmental Peripheral Board (SPX-18976): https://www.sparkfun.com/products/18976
+ * 
+ * Please see LICENSE.md for the license information
+ * 
+ */
+
+#include <SparkFun_VEML7700_Arduino_Library.h> // Click here to get the library: http://librarymanager/All#SparkFun_VEML7700
+
+VEML7700 mySensor; // Create a VEML7700 object
+
+VEML7700Flicker myFlicker; // Create the flicker analysis
+
+#define NUM_SAMPLES 128 // 128 samples take approximately 3.8 seconds
+uint16_t samples[NUM_SAMPLES]; // The burst. 2 bytes per sample
+
+const char *frequencyNames[] = { "50Hz", "60Hz", "100Hz", "120Hz" };
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println(F("SparkFun VEML7700 Example"));
+
+  Wire.begin();
+
+  //mySensor.enableDebugging(); // Uncomment this line to enable helpful debug messages on Serial
+
+  // Begin the VEML7700 using the Wire I2C port
+  // .begin will return true on success, or false on failure to communicate
+  if (mySensor.begin() == false)
+  {
+    Serial.println("Unable to communicate with the VEML7700. Please check the wiring. Freezing...");
+    while (1)
+      ;
+  }
+
+  mySensor.enableConfigurationCache(); // Each sample will then only need to read the ALS_OUTPUT
+
+  mySensor.setIntegrationTime(VEML7700_INTEGRATION_25ms); // Longer integration times average the flicker away
+}
+
+void loop()
+{
+  VEML7700_error_t err = mySensor.measureFlicker(&myFlicker, samples, NUM_SAMPLES);
+
+  if (err != VEML7700_SUCCESS)
+  {
+    Serial.print(F("measureFlicker failed: "));
+    Serial.println(err);
+  }
+  else
+  {
+    for (uint8_t f = 0; f < VEML7700_FLICKER_INVALID; f++)
+    {
+      Serial.print(frequencyNames[f]);
+      Serial.print(F(": "));
+
+      float depth;
+      if (myFlicker.getDepth((VEML7700_flicker_frequency_t)f, &depth) == VEML7700_SUCCESS)
+      {
+        Serial.print(depth * 100.0, 1);
+        Serial.print(F("%"));
+      }
+      else
+      {
+        Serial.print(F("not observable"));
+      }
+
+      Serial.print(F("\t"));
+    }
+    Serial.println();
+  }
+}
@@ -0,0 +1,102 @@
+/*!
+ * @file Example17_warmStart.ino
+ *
+ * This example was written by:
+ * SparkFun Electronics
+ * October 14th 2026
+ * 
+ * This example demonstrates how to save the sensor state in EEPROM, for a fast warm start.
+ * On every boot, begin normally writes the default configuration and auto-ranging then needs
+ * several conversions to find the right range again. Here, the state is saved after each
+ * reading and restored before begin, so begin comes up straight in the last good range.
+ * The per-unit calibration is saved too.
+ * The snapshot has a checksum: on the very first boot, restoreState fails and begin uses the defaults.
+ * 
+ * Want to support open source hardware? Buy a board from SparkFun!
+ * <br>SparkX smôl Environmental Peripheral Board (SPX-18976): https://www.sparkfun.com/products/18976
+ * 
+ * Please see LICENSE.md for the license information
+ * 
+ */
+
+#include <SparkFun_VEML7700_Arduino_Library.h> // Click here to get the library: http://librarymanager/All#SparkFun_VEML7700
+
+#include <EEPROM.h>
+
+VEML7700 mySensor; // Create a VEML7700 object
+
+#define STATE_ADDRESS 0 // Where the snapshot is stored in EEPROM
+
+uint8_t state[VEML7700_STATE_SIZE];
+
+void loadState()
+{
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266)
+  EEPROM.begin(STATE_ADDRESS + VEML7700_STATE_SIZE); // The ESP32 and ESP8266 emulate EEPROM in flash
+#endif
+  for (uint8_t i = 0; i < VEML7700_STATE_SIZE; i++)
+    state[i] = EEPROM.read(STATE_ADDRESS + i);
+}
+
+void storeState()
+{
+  for (uint8_t i = 0; i < VEML7700_STATE_SIZE; i++)
+    EEPROM.write(STATE_ADDRESS + i, state[i]);
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266)
+  EEPROM.commit();
+#endif
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println(F("SparkFun VEML7700 Example"));
+
+  Wire.begin();
+
+  //mySensor.enableDebugging(); // Uncomment this line to enable helpful debug messages on Serial
+
+  // Restore the saved state. begin will then use it
+  loadState();
+  if (mySensor.restoreState(state) == VEML7700_SUCCESS)
+    Serial.println(F("Restored the saved state"));
+  else
+    Serial.println(F("No saved state. Using the defaults"));
+
+  // Begin the VEML7700 using the Wire I2C port
+  // .begin will return true on success, or false on failure to communicate
+  if (mySensor.begin() == false)
+  {
+    Serial.println("Unable to communicate with the VEML7700. Please check the wiring. Freezing...");
+    while (1)
+      ;
+  }
+
+  mySensor.enableConfigurationCache(); // saveState then only needs to read the thresholds, if at all
+
+  //mySensor.setCalibration(1.05, 0.0); // Uncomment this line to set this unit's calibration. It is saved with the state
+
+  mySensor.enableAutoRange(); // Let's find the best range
+}
+
+void loop()
+{
+  float lux;
+
+  if (mySensor.getAutoRangedLux(&lux) == VEML7700_SUCCESS)
+  {
+    Serial.print(F("Lux: "));
+    Serial.print(lux, 4);
+    Serial.print(F("\tGain: "));
+    Serial.print(mySensor.getSensitivityModeStr());
+    Serial.print(F("\tIntegration Time: "));
+    Serial.println(mySensor.getIntegrationTimeStr());
+
+    // Save the state. A real application would only do this occasionally (e.g. before sleeping),
+    // to avoid wearing out the EEPROM
+    if (mySensor.saveState(state) == VEML7700_SUCCESS)
+      storeState();
+  }
+
+  delay(5000);
+}
@@ -0,0 +1,86 @@
+/*!
+ * @file Example18_sinks.ino
+ *
+ * This example was written by:
+ * SparkFun Electronics
+ * October 14th 2026
+ * 
+ * This example demonstrates how to share each reading between several consumers.
+ * poll reads each fresh conversion once and publishes it to every sink.
+ * Here, a dimming controller wants every reading which has changed by at least 5 lux,
+ * telemetry wants every 10th reading and a logger wants every reading.
+ * That is one I2C read per conversion, however many consumers there are.
+ * 
+ * Want to support open source hardware? Buy a board from SparkFun!
+ * <br>SparkX smôl Environmental Peripheral Board (SPX-18976): https://www.sparkfun.com/products/18976
+ * 
+ * Please see LICENSE.md for the license information
+ * 
+ */
+
+#include <SparkFun_VEML7700_Arduino_Library.h> // Click here to get the library: http://librarymanager/All#SparkFun_VEML7700
+
+VEML7700 mySensor; // Create a VEML7700 object
+
+void dimming(uint16_t ambient, float lux, void *context)
+{
+  Serial.print(F("Dimming: the lux changed to "));
+  Serial.println(lux, 4);
+}
+
+void telemetry(uint16_t ambient, float lux, void *context)
+{
+  Serial.print(F("Telemetry: "));
+  Serial.println(lux, 4);
+}
+
+void logger(uint16_t ambient, float lux, void *context)
+{
+  unsigned long *count = (unsigned long *)context; // The context can point to the sink's own data
+  (*count)++;
+}
+
+unsigned long readingsLogged = 0;
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println(F("SparkFun VEML7700 Example"));
+
+  Wire.begin();
+
+  //mySensor.enableDebugging(); // Uncomment this line to enable helpful debug messages on Serial
+
+  // Begin the VEML7700 using the Wire I2C port
+  // .begin will return true on success, or false on failure to communicate
+  if (mySensor.begin() == false)
+  {
+    Serial.println("Unable to communicate with the VEML7700. Please check the wiring. Freezing...");
+    while (1)
+      ;
+  }
+
+  mySensor.enableConfigurationCache(); // Each poll will then only need to read the ALS_OUTPUT
+
+  mySensor.addSink(dimming, NULL, 1, 5.0); // Every reading which has changed by at least 5 lux
+  mySensor.addSink(telemetry, NULL, 10); // Every 10th reading (approximately once per second)
+  mySensor.addSink(logger, &readingsLogged); // Every reading
+
+  mySensor.startMeasurement(); // Start the measurements
+}
+
+void loop()
+{
+  float lux;
+
+  // poll publishes each fresh reading to the sinks
+  mySensor.poll(&lux);
+
+  static unsigned long lastPrint = 0;
+  if (millis() - lastPrint >= 10000)
+  {
+    lastPrint = millis();
+    Serial.print(F("Readings logged: "));
+    Serial.println(readingsLogged);
+  }
+}
@@ -0,0 +1,72 @@
+/*!
+ * @file Example19_adaptiveScheduler.ino
+ *
+ * This example was written by:
+ * SparkFun Electronics
+ * October 14th 2026
+ * 
+ * This example demonstrates how to make the sampling follow the light.
+ * While the light is stable, the scheduler lengthens the interval: power saving modes 1 to 4,
+ * then shut down between samples, up to once per minute.
+ * When the light changes fast, it drops straight back to the 25ms integration time.
+ * Between samples, the processor can sleep until nextWakeMillis.
+ * 
+ * Want to support open source hardware? Buy a board from SparkFun!
+ * <br>SparkX smôl Environmental Peripheral Board (SPX-18976): https://www.sparkfun.com/products/18976
+ * 
+ * Please see LICENSE.md for the license information
+ * 
+ */
+
+#include <SparkFun_VEML7700_Arduino_Library.h> // Click here to get the library: http://librarymanager/All#SparkFun_VEML7700
+
+VEML7700 mySensor; // Create a VEML7700 object
+
+VEML7700Statistics statistics; // The scheduler compares each sample with the EMA
+
+VEML7700AdaptiveScheduler scheduler;
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println(F("SparkFun VEML7700 Example"));
+
+  Wire.begin();
+
+  //mySensor.enableDebugging(); // Uncomment this line to enable helpful debug messages on Serial
+
+  // Begin the VEML7700 using the Wire I2C port
+  // .begin will return true on success, or false on failure to communicate
+  if (mySensor.begin() == false)
+  {
+    Serial.println("Unable to communicate with the VEML7700. Please check the wiring. Freezing...");
+    while (1)
+      ;
+  }
+
+  mySensor.enableConfigurationCache(); // Each sample will then only need to read the ALS_OUTPUT
+
+  //scheduler.setChangeThresholds(0.05, 0.25); // Uncomment this line to change how much change is stable (5%) and fast (25%)
+  //scheduler.setMaxIntervalMillis(300000); // Uncomment this line to sample at least once every five minutes
+
+  scheduler.begin(mySensor, statistics); // Start the adaptive sampling
+}
+
+void loop()
+{
+  float lux;
+
+  if (scheduler.service(&lux) == VEML7700_SUCCESS)
+  {
+    Serial.print(F("Lux: "));
+    Serial.print(lux, 4);
+    Serial.print(F("  Level: "));
+    Serial.print(scheduler.getLevel());
+    Serial.print(F("  Next sample in: "));
+    Serial.print(scheduler.getIntervalMillis());
+    Serial.println(F("ms"));
+  }
+
+  // Replace this with your low power sleep, for millisUntilWake milliseconds
+  delay(scheduler.millisUntilWake());
+}
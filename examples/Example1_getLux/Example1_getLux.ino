@@ -19,6 +19,10 @@
 
 VEML7700 mySensor; // Create a VEML7700 object
 
+// If the gain and integration time never change, we can fix them at compile time instead.
+// getLux is then a single I2C read and one multiply:
+//VEML7700Fixed<VEML7700_SENSITIVITY_x1, VEML7700_INTEGRATION_100ms> mySensor;
+
 void setup()
 {
   Serial.begin(115200);
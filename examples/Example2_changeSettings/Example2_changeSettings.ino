@@ -78,6 +78,15 @@ void setup()
   Serial.print(F("The sensor persistence protect setting is: "));
   Serial.println(mySensor.getPersistenceProtectStr());  
 
+  //We can also change all of the settings with a single I2C write, using applyConfiguration:
+  //VEML7700_config_t config;
+  //config.shutdown = VEML7700_POWER_ON;
+  //config.interruptEnable = VEML7700_INT_DISABLE;
+  //config.persistenceProtect = VEML7700_PERSISTENCE_4;
+  //config.integrationTime = VEML7700_INTEGRATION_50ms;
+  //config.sensitivityMode = VEML7700_SENSITIVITY_x2;
+  //mySensor.applyConfiguration(config); // This would do the same thing
+
   Serial.println(F("Lux:\tAmbient:\tWhite Level:"));
 }
 
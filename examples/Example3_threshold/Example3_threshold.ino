@@ -39,6 +39,7 @@ void setup()
 
   //Let's change the high threshold to 30000 counts:
   mySensor.setHighThreshold(30000);
+  //mySensor.setHighThresholdLux(500.0); // Or set the threshold in lux. It is rescaled automatically if the gain or integration time change
 
   //Confirm the high threshold was set correctly
   Serial.print(F("The high threshold is: "));
@@ -46,6 +47,7 @@ void setup()
 
   //Let's change the low threshold to 1000 counts:
   mySensor.setLowThreshold(1000);
+  //mySensor.setLowThresholdLux(10.0); // Or set the threshold in lux
 
   //Confirm the low threshold was set correctly
   Serial.print(F("The low threshold is: "));
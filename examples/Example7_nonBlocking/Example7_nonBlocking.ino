@@ -0,0 +1,66 @@
+/*!
+ * @file Example7_nonBlocking.ino
+ *
+ * This example was written by:
+ * SparkFun Electronics
+ * October 14th 2026
+ * 
+ * This example demonstrates how to read the lux without using delay().
+ * poll only returns a new reading when a fresh conversion is available,
+ * so loop is free to do other things in the meantime and no reading is printed twice.
+ * 
+ * Want to support open source hardware? Buy a board from SparkFun!
+ * <br>SparkX smôl Environmental Peripheral Board (SPX-18976): https://www.sparkfun.com/products/18976
+ * 
+ * Please see LICENSE.md for the license information
+ * 
+ */
+
+#include <SparkFun_VEML7700_Arduino_Library.h> // Click here to get the library: http://librarymanager/All#SparkFun_VEML7700
+
+VEML7700 mySensor; // Create a VEML7700 object
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println(F("SparkFun VEML7700 Example"));
+
+  Wire.begin();
+
+  //mySensor.enableDebugging(); // Uncomment this line to enable helpful debug messages on Serial
+
+  // Begin the VEML7700 using the Wire I2C port
+  // .begin will return true on success, or false on failure to communicate
+  if (mySensor.begin() == false)
+  {
+    Serial.println("Unable to communicate with the VEML7700. Please check the wiring. Freezing...");
+    while (1)
+      ;
+  }
+
+  mySensor.enableConfigurationCache(); // Each poll will then only need to read the ALS_OUTPUT
+
+  mySensor.setIntegrationTime(VEML7700_INTEGRATION_200ms); // Let's use a 200ms integration time
+
+  Serial.print(F("A new conversion will be available every "));
+  Serial.print(mySensor.getMeasurementPeriodMillis());
+  Serial.println(F("ms"));
+
+  mySensor.startMeasurement(); // Start the measurements
+
+  Serial.println(F("Lux:"));
+}
+
+void loop()
+{
+  float lux;
+
+  // poll will return VEML7700_SUCCESS when a fresh conversion has been read,
+  // or VEML7700_ERROR_NOT_READY if the conversion is still in progress
+  if (mySensor.poll(&lux) == VEML7700_SUCCESS)
+  {
+    Serial.println(lux, 4);
+  }
+
+  // Do other things here!
+}
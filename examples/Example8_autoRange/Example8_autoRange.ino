@@ -0,0 +1,74 @@
+/*!
+ * @file Example8_autoRange.ino
+ *
+ * This example was written by:
+ * SparkFun Electronics
+ * October 14th 2026
+ * 
+ * This example demonstrates how to let the library choose the gain (sensitivity) and integration time.
+ * The range is changed automatically when the ALS count is too low (poor resolution)
+ * or too high (close to saturation).
+ * 
+ * Want to support open source hardware? Buy a board from SparkFun!
+ * <br>SparkX smôl Environmental Peripheral Board (SPX-18976): https://www.sparkfun.com/products/18976
+ * 
+ * Please see LICENSE.md for the license information
+ * 
+ */
+
+#include <SparkFun_VEML7700_Arduino_Library.h> // Click here to get the library: http://librarymanager/All#SparkFun_VEML7700
+
+VEML7700 mySensor; // Create a VEML7700 object
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println(F("SparkFun VEML7700 Example"));
+
+  Wire.begin();
+
+  //mySensor.enableDebugging(); // Uncomment this line to enable helpful debug messages on Serial
+
+  // Begin the VEML7700 using the Wire I2C port
+  // .begin will return true on success, or false on failure to communicate
+  if (mySensor.begin() == false)
+  {
+    Serial.println("Unable to communicate with the VEML7700. Please check the wiring. Freezing...");
+    while (1)
+      ;
+  }
+
+  mySensor.enableConfigurationCache(); // Range changes will then only need a single write
+
+  //The default hysteresis band is 100 to 10000 counts. We can change it with:
+  //mySensor.setAutoRangeThresholds(100, 10000);
+
+  mySensor.enableAutoRange(); // Enable auto-ranging
+
+  //The range is predicted from each reading, so a valid reading normally needs only two conversions.
+  //Let's print the worst-case time to a valid reading, starting from the default range (x1, 100ms):
+  Serial.print(F("Worst-case time to a valid reading: "));
+  Serial.print(mySensor.getAutoRangeWorstCaseMillis(VEML7700_SENSITIVITY_x1, VEML7700_INTEGRATION_100ms));
+  Serial.println(F("ms"));
+
+  mySensor.startMeasurement(); // Start the measurements
+
+  Serial.println(F("Lux:\tGain:\tIntegration Time:\tConversions:"));
+}
+
+void loop()
+{
+  float lux;
+
+  // poll returns VEML7700_ERROR_NOT_READY while the range is being changed
+  if (mySensor.poll(&lux) == VEML7700_SUCCESS)
+  {
+    Serial.print(lux, 4);
+    Serial.print(F("\t"));
+    Serial.print(mySensor.getSensitivityModeStr());
+    Serial.print(F("\t"));
+    Serial.print(mySensor.getIntegrationTimeStr());
+    Serial.print(F("\t\t\t"));
+    Serial.println(mySensor.getAutoRangeConversions()); // How many conversions were needed to get a valid reading
+  }
+}
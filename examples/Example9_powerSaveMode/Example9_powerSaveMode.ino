@@ -0,0 +1,76 @@
+/*!
+ * @file Example9_powerSaveMode.ino
+ *
+ * This example was written by:
+ * SparkFun Electronics
+ * October 14th 2026
+ * 
+ * This example demonstrates how to use the VEML7700's power saving mode (PSM).
+ * In power saving mode, the sensor waits between conversions, reducing the average current.
+ * poll knows about the wait time, so each reading is collected as soon as it is available.
+ * 
+ * Want to support open source hardware? Buy a board from SparkFun!
+ * <br>SparkX smôl Environmental Peripheral Board (SPX-18976): https://www.sparkfun.com/products/18976
+ * 
+ * Please see LICENSE.md for the license information
+ * 
+ */
+
+#include <SparkFun_VEML7700_Arduino_Library.h> // Click here to get the library: http://librarymanager/All#SparkFun_VEML7700
+
+VEML7700 mySensor; // Create a VEML7700 object
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println(F("SparkFun VEML7700 Example"));
+
+  Wire.begin();
+
+  //mySensor.enableDebugging(); // Uncomment this line to enable helpful debug messages on Serial
+
+  // Begin the VEML7700 using the Wire I2C port
+  // .begin will return true on success, or false on failure to communicate
+  if (mySensor.begin() == false)
+  {
+    Serial.println("Unable to communicate with the VEML7700. Please check the wiring. Freezing...");
+    while (1)
+      ;
+  }
+
+  mySensor.enableConfigurationCache(); // Each poll will then only need to read the ALS_OUTPUT
+
+  //The power saving mode sets the wait time between conversions.
+  //Possible values are:
+  //VEML7700_POWER_SAVE_MODE_1 (500ms)
+  //VEML7700_POWER_SAVE_MODE_2 (1000ms)
+  //VEML7700_POWER_SAVE_MODE_3 (2000ms)
+  //VEML7700_POWER_SAVE_MODE_4 (4000ms)
+  //Let's use mode 2:
+  mySensor.setPowerSaveMode(VEML7700_POWER_SAVE_MODE_2);
+
+  //Confirm the power saving mode was set correctly
+  Serial.print(F("The power saving mode is: "));
+  Serial.println(mySensor.getPowerSaveModeStr());
+
+  //Enable power saving mode
+  mySensor.setPowerSaveEnable(VEML7700_POWER_SAVE_ENABLE);
+
+  Serial.print(F("A new conversion will be available every "));
+  Serial.print(mySensor.getMeasurementPeriodMillis());
+  Serial.println(F("ms"));
+
+  mySensor.startMeasurement(); // Start the measurements
+
+  Serial.println(F("Lux:"));
+}
+
+void loop()
+{
+  float lux;
+
+  if (mySensor.poll(&lux) == VEML7700_SUCCESS) // poll only reads the sensor when a new conversion is available
+  {
+    Serial.println(lux, 4);
+  }
+}
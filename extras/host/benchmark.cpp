@@ -0,0 +1,129 @@
+/*
+  Host benchmark of the library's hot paths, with the emulated sensors from Example15_benchmark.
+
+  Each call is repeated and timed with the host clock. delay() does not wait on the host
+  (see stub/Arduino.h), so the times are for the library code alone. The conversion time
+  the library waited for is reported separately, as "waited".
+  The bus transactions per call are checked against the expected counts, so that a
+  regression (e.g. an extra configuration read) fails the test.
+
+  Returns 0 if every call succeeded with the expected number of transactions.
+*/
+
+#include <SparkFun_VEML7700_Arduino_Library.h>
+#include <EmulatedVEML7700.h>
+#include <chrono>
+
+static EmulatedVEML7700 emulator;
+static VEML7700 mySensor;
+static VEML7700Array<NUM_EMULATED_SENSORS> mySensors(selectMuxChannel, &emulator);
+
+static int failures = 0;
+
+// Call fn repeats times (after a warm-up call if repeats > 1). Print the time per call, the waiting per call and the transactions per call
+template <typename F>
+static void benchmark(const char *name, unsigned long repeats, unsigned long expectedTransactions, F fn)
+{
+  bool success = true;
+
+  if (repeats > 1)
+    success = fn(); // Warm up. The first call can differ, e.g. in the range it starts from
+
+  emulator.resetCounts();
+  unsigned long long startDelayed = hostDelayedMicros();
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (unsigned long i = 0; i < repeats; i++)
+    success = fn() && success;
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+  double nanos = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / repeats;
+  double waited = (double)(hostDelayedMicros() - startDelayed) / repeats;
+  unsigned long transactions = emulator.transactions / repeats;
+
+  printf("%-40s %9.0f ns  waited %8.0f us  transactions %3lu  bytes %4lu", name, nanos, waited,
+         transactions, emulator.bytes / repeats);
+
+  if (!success)
+  {
+    printf("  FAILED");
+    failures++;
+  }
+  else if ((emulator.transactions % repeats != 0) || (transactions != expectedTransactions))
+  {
+    printf("  FAILED (expected %lu transactions)", expectedTransactions);
+    failures++;
+  }
+  printf("\n");
+}
+
+int main()
+{
+  float lux;
+  uint32_t milliLux;
+  uint16_t ambient, white;
+
+  emulator.channel = 0;
+
+  benchmark("begin", 1, 2, []() { return (mySensor.begin(emulator)); });
+
+  benchmark("getLux (uncached)", 1000, 3,
+            [&]() { return (mySensor.getLux(&lux) == VEML7700_ERROR_SUCCESS); });
+
+  benchmark("setIntegrationTime (uncached)", 1000, 2,
+            []() { return (mySensor.setIntegrationTime(VEML7700_INTEGRATION_200ms) == VEML7700_ERROR_SUCCESS); });
+
+  mySensor.enableConfigurationCache();
+  mySensor.syncConfiguration();
+
+  benchmark("getLux (cached)", 10000, 1,
+            [&]() { return (mySensor.getLux(&lux) == VEML7700_ERROR_SUCCESS); });
+
+  benchmark("getLuxMilli (cached)", 10000, 1,
+            [&]() { return (mySensor.getLuxMilli(&milliLux) == VEML7700_ERROR_SUCCESS); });
+
+  benchmark("getLuxCorrected (cached)", 10000, 1,
+            [&]() { return (mySensor.getLuxCorrected(&lux) == VEML7700_ERROR_SUCCESS); });
+
+  benchmark("setIntegrationTime (cached)", 10000, 1,
+            []() { return (mySensor.setIntegrationTime(VEML7700_INTEGRATION_100ms) == VEML7700_ERROR_SUCCESS); });
+
+  benchmark("getAmbientAndWhite", 10000, 3,
+            [&]() { return (mySensor.getAmbientAndWhite(&ambient, &white) == VEML7700_ERROR_SUCCESS); });
+
+  // Auto-range convergence: start at the least sensitive setting, in dim light
+  emulator.lux[0] = 5.0;
+  benchmark("getAutoRangedLux (dim, from x1/8 25ms)", 100, 5, [&]() {
+    mySensor.setSensitivityMode(VEML7700_SENSITIVITY_x1_8);
+    mySensor.setIntegrationTime(VEML7700_INTEGRATION_25ms);
+    return (mySensor.getAutoRangedLux(&lux) == VEML7700_ERROR_SUCCESS);
+  });
+  printf("  conversions: %u\n", mySensor.getAutoRangeConversions());
+
+  // Now light that saturates the sensor
+  emulator.lux[0] = 50000.0;
+  benchmark("getAutoRangedLux (bright, saturated)", 1, 3,
+            [&]() { return (mySensor.getAutoRangedLux(&lux) == VEML7700_ERROR_SUCCESS); });
+  printf("  conversions: %u\n", mySensor.getAutoRangeConversions());
+
+  mySensor.shutdown();
+
+  // Multi-sensor sweep
+  for (uint8_t c = 0; c < NUM_EMULATED_SENSORS; c++)
+  {
+    emulator.lux[c] = 100.0;
+    mySensors.addSensor(c);
+  }
+
+  benchmark("VEML7700Array begin", 1, 12, []() { return (mySensors.begin(emulator)); });
+
+  float luxes[NUM_EMULATED_SENSORS];
+
+  mySensors.sweep(luxes); // The first sweep starts the measurements
+
+  benchmark("VEML7700Array sweep", 100, 7,
+            [&]() { return (mySensors.sweep(luxes) == NUM_EMULATED_SENSORS); });
+  printf("  mux selects per sweep: %lu\n", emulator.muxSelects / 100);
+
+  return ((failures == 0) ? 0 : 1);
+}
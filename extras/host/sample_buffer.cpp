@@ -0,0 +1,97 @@
+/*
+  Host test of the VEML7700SampleBuffer timestamps.
+
+  - A buffer with capacity 1 keeps the timestamp of the newest sample when it overwrites.
+  - Gaps longer than the largest delta (255 ticks) are kept exactly, as gap records.
+  - Gap records use a slot but are never drained, and overwriting a full buffer drops them
+    with their sample.
+
+  Returns 0 if every drained timestamp matches the time it was pushed.
+*/
+
+#include <SparkFun_VEML7700_Arduino_Library.h>
+
+static VEML7700SampleBuffer<1> one;
+static VEML7700SampleBuffer<4> four;
+
+static int failures = 0;
+
+// Drain buffer and compare the ambient and timestamps with the expected values
+static void check(const char *name, VEML7700SampleBufferBase &buffer, const uint16_t *ambient,
+                  const unsigned long *timestamps, uint16_t count)
+{
+  VEML7700_sample_t samples[8];
+  unsigned long drained[8];
+
+  if (buffer.available() != count)
+  {
+    printf("FAILED: %s: available %u, expected %u\n", name, buffer.available(), count);
+    failures++;
+  }
+
+  uint16_t n = buffer.drain(samples, 8, drained);
+
+  if (n != count)
+  {
+    printf("FAILED: %s: drained %u, expected %u\n", name, n, count);
+    failures++;
+    return;
+  }
+
+  for (uint16_t i = 0; i < n; i++)
+  {
+    if ((samples[i].ambient != ambient[i]) || (drained[i] != timestamps[i]))
+    {
+      printf("FAILED: %s: sample %u is %u at %lums, expected %u at %lums\n", name, i,
+             samples[i].ambient, drained[i], ambient[i], timestamps[i]);
+      failures++;
+    }
+  }
+}
+
+int main()
+{
+  // Capacity 1: each push overwrites the last sample, including after a long gap
+  {
+    one.push(1, VEML7700_SENSITIVITY_x1, VEML7700_INTEGRATION_100ms, 1000);
+    one.push(2, VEML7700_SENSITIVITY_x1, VEML7700_INTEGRATION_100ms, 1100);
+    one.push(3, VEML7700_SENSITIVITY_x1, VEML7700_INTEGRATION_100ms, 50000);
+
+    const uint16_t ambient[] = { 3 };
+    const unsigned long timestamps[] = { 50000 };
+    check("capacity 1", one, ambient, timestamps, 1);
+
+    if (one.getOverwriteCount() != 2)
+    {
+      printf("FAILED: capacity 1: %lu overwrites, expected 2\n", (unsigned long)one.getOverwriteCount());
+      failures++;
+    }
+  }
+
+  // Gaps of 20s and 1 hour, with the oldest samples overwritten
+  {
+    const unsigned long pushed[] = { 1000, 1100, 21100, 21125, 3600000UL + 21125 };
+    for (uint16_t i = 0; i < 5; i++)
+      four.push(10 + i, VEML7700_SENSITIVITY_x1, VEML7700_INTEGRATION_100ms, pushed[i]);
+
+    const uint16_t ambient[] = { 12, 13, 14 };
+    const unsigned long timestamps[] = { 21100, 21125, 3600000UL + 21125 };
+    check("long gaps", four, ambient, timestamps, 3);
+  }
+
+  // Gap records overwritten along with their samples
+  {
+    const unsigned long pushed[] = { 0, 10000, 20000, 20025, 20050, 40000 };
+    for (uint16_t i = 0; i < 6; i++)
+      four.push(20 + i, VEML7700_SENSITIVITY_x1, VEML7700_INTEGRATION_100ms, pushed[i]);
+
+    const uint16_t ambient[] = { 23, 24, 25 };
+    const unsigned long timestamps[] = { 20025, 20050, 40000 };
+    check("overwritten gaps", four, ambient, timestamps, 3);
+  }
+
+  if (failures == 0)
+    printf("All sample buffer checks passed\n");
+
+  return ((failures == 0) ? 0 : 1);
+}
@@ -0,0 +1,67 @@
+/*
+  Host test of VEML7700AdaptiveScheduler with a non-unity calibration.
+
+  The emulated light is steady, so the scheduler should step from its fast level up to
+  the longest (shut down) interval. It can only do that if it compares each calibrated
+  sample with the calibrated EMA: with gain 1.3 and offset 25 lux, comparing against the
+  uncalibrated EMA looks like a 55% change on every sample.
+
+  Returns 0 if the longest interval is reached.
+*/
+
+#include <SparkFun_VEML7700_Arduino_Library.h>
+#include <EmulatedVEML7700.h>
+
+static EmulatedVEML7700 emulator;
+static VEML7700 mySensor;
+static VEML7700Statistics statistics;
+static VEML7700AdaptiveScheduler scheduler;
+
+int main()
+{
+  const unsigned long maxInterval = 60000;
+  float lux;
+
+  emulator.channel = 0;
+  emulator.lux[0] = 100.0;
+
+  if (!mySensor.begin(emulator)
+      || (mySensor.setCalibration(1.3, 25.0) != VEML7700_ERROR_SUCCESS)
+      || (scheduler.begin(mySensor, statistics) != VEML7700_ERROR_SUCCESS))
+  {
+    printf("FAILED: begin\n");
+    return (1);
+  }
+
+  scheduler.setMaxIntervalMillis(maxInterval);
+
+  unsigned long startMillis = millis();
+  uint8_t level = 0xFF;
+
+  // Ten minutes of steady light is plenty to climb all of the levels
+  while ((millis() - startMillis) < 600000)
+  {
+    delay(scheduler.millisUntilWake()); // Does not wait on the host. See stub/Arduino.h
+
+    VEML7700_error_t err = scheduler.service(&lux);
+
+    if ((err != VEML7700_ERROR_SUCCESS) && (err != VEML7700_ERROR_NOT_READY))
+    {
+      printf("FAILED: service error %d\n", err);
+      return (1);
+    }
+
+    if ((err == VEML7700_ERROR_SUCCESS) && (scheduler.getLevel() != level))
+    {
+      level = scheduler.getLevel();
+      printf("t=%6lums level %u interval %5lums lux %.2f\n", millis() - startMillis, level,
+             scheduler.getIntervalMillis(), lux);
+    }
+
+    if (scheduler.getIntervalMillis() == maxInterval)
+      return (0);
+  }
+
+  printf("FAILED: stuck at level %u, interval %lums\n", scheduler.getLevel(), scheduler.getIntervalMillis());
+  return (1);
+}
@@ -0,0 +1,62 @@
+/*
+  Host test of the VEML7700Statistics mean and variance over a long stream.
+
+  Two million samples (about 14 hours at the 25ms rate) at the least sensitive range (x1/8, 25ms),
+  where the normalized counts are above 2^24. Half way through, the light steps up.
+  The mean and variance are compared with a two-pass double precision reference.
+
+  Returns 0 if both are within 0.01%.
+*/
+
+#include <SparkFun_VEML7700_Arduino_Library.h>
+#include <math.h>
+
+#define NUM_SAMPLES 2000000UL
+#define TOLERANCE 1e-4
+
+static VEML7700Statistics statistics;
+static uint16_t samples[NUM_SAMPLES];
+
+// A repeatable pseudo-random sequence (LCG)
+static uint32_t nextRandom()
+{
+  static uint32_t state = 12345;
+  state = (state * 1664525UL) + 1013904223UL;
+  return (state >> 8);
+}
+
+static bool check(const char *name, double value, double expected)
+{
+  double error = fabs(value - expected) / expected;
+  printf("%-10s %14.6f expected %14.6f error %.2e%s\n", name, value, expected, error,
+         (error <= TOLERANCE) ? "" : "  FAILED");
+  return (error <= TOLERANCE);
+}
+
+int main()
+{
+  // Noise of +/- 500 counts around 40000, then around 60000
+  for (unsigned long i = 0; i < NUM_SAMPLES; i++)
+    samples[i] = (uint16_t)(((i < (NUM_SAMPLES / 2)) ? 39500 : 59500) + (nextRandom() % 1001));
+
+  for (unsigned long i = 0; i < NUM_SAMPLES; i++)
+    statistics.add(samples[i], VEML7700_SENSITIVITY_x1_8, VEML7700_INTEGRATION_25ms);
+
+  // The lux per count at x1/8, 25ms
+  const double resolution = 1.8432;
+
+  double mean = 0.0;
+  for (unsigned long i = 0; i < NUM_SAMPLES; i++)
+    mean += samples[i];
+  mean /= NUM_SAMPLES;
+
+  double m2 = 0.0;
+  for (unsigned long i = 0; i < NUM_SAMPLES; i++)
+    m2 += (samples[i] - mean) * (samples[i] - mean);
+
+  bool success = (statistics.getCount() == NUM_SAMPLES);
+  success = check("mean", statistics.getMeanLux(), mean * resolution) && success;
+  success = check("variance", statistics.getVarianceLux(), (m2 / (NUM_SAMPLES - 1)) * resolution * resolution) && success;
+
+  return (success ? 0 : 1);
+}
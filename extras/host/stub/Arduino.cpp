@@ -0,0 +1,34 @@
+/*
+  Minimal Arduino core for building the library on a PC (see Arduino.h)
+*/
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <chrono>
+
+HardwareSerial Serial;
+TwoWire Wire;
+
+static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+static unsigned long long delayedMicros = 0;
+
+unsigned long micros()
+{
+  return ((unsigned long)(delayedMicros
+                          + std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count()));
+}
+
+unsigned long millis() { return ((unsigned long)(micros() / 1000)); }
+void delay(unsigned long ms) { delayedMicros += (unsigned long long)ms * 1000; }
+void delayMicroseconds(unsigned int us) { delayedMicros += us; }
+void yield() {}
+unsigned long long hostDelayedMicros() { return (delayedMicros); }
+
+void pinMode(uint8_t, uint8_t) {}
+int digitalRead(uint8_t) { return (HIGH); }
+void digitalWrite(uint8_t, uint8_t) {}
+int digitalPinToInterrupt(uint8_t pin) { return (pin); }
+void attachInterrupt(int, void (*)(void), int) {}
+void detachInterrupt(int) {}
+void noInterrupts() {}
+void interrupts() {}
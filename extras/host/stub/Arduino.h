@@ -0,0 +1,97 @@
+/*
+  Minimal Arduino core for building the library on a PC (see ../CMakeLists.txt).
+  Only what the library and the host programs use is provided.
+  delay and delayMicroseconds do not sleep. They advance the clock returned by
+  millis and micros, so the library sees the time pass but the host does not wait.
+*/
+
+#ifndef ARDUINO_HOST_STUB_H
+#define ARDUINO_HOST_STUB_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include <stdio.h>
+
+typedef bool boolean;
+
+#define PI 3.1415926535897932384626433832795
+
+#define HEX 16
+#define DEC 10
+
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define LOW 0
+#define HIGH 1
+#define FALLING 2
+#define NOT_AN_INTERRUPT -1
+
+// Flash is ordinary memory on the host
+#define PROGMEM
+#define PGM_P const char *
+#define pgm_read_byte(a) (*(const uint8_t *)(a))
+#define pgm_read_word(a) (*(const uint16_t *)(a))
+#define pgm_read_dword(a) (*(const uint32_t *)(a))
+#define pgm_read_float(a) (*(const float *)(a))
+#define pgm_read_ptr(a) (*(const void *const *)(a))
+#define strlen_P strlen
+#define strncpy_P strncpy
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+#define FPSTR(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+/** The total time "spent" in delay and delayMicroseconds (us) */
+unsigned long long hostDelayedMicros();
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalPinToInterrupt(uint8_t pin);
+void attachInterrupt(int interrupt, void (*isr)(void), int mode);
+void detachInterrupt(int interrupt);
+void noInterrupts();
+void interrupts();
+
+/** Print writes to stdout */
+class Print
+{
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) { return (fputc(c, stdout) == EOF ? 0 : 1); }
+  size_t print(const char *s) { return (printf("%s", s)); }
+  size_t print(const __FlashStringHelper *s) { return (print((const char *)s)); }
+  size_t print(char c) { return (write((uint8_t)c)); }
+  size_t print(int v, int base = DEC) { return (printf(base == HEX ? "%X" : "%d", v)); }
+  size_t print(unsigned int v, int base = DEC) { return (printf(base == HEX ? "%X" : "%u", v)); }
+  size_t print(long v, int base = DEC) { return (printf(base == HEX ? "%lX" : "%ld", v)); }
+  size_t print(unsigned long v, int base = DEC) { return (printf(base == HEX ? "%lX" : "%lu", v)); }
+  size_t print(double v, int digits = 2) { return (printf("%.*f", digits, v)); }
+  size_t println() { return (print("\r\n")); }
+  template <typename T> size_t println(T v) { return (print(v) + println()); }
+  template <typename T> size_t println(T v, int format) { return (print(v, format) + println()); }
+};
+
+class Stream : public Print
+{
+};
+
+class HardwareSerial : public Stream
+{
+public:
+  void begin(unsigned long) {}
+  operator bool() { return (true); }
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,29 @@
+/*
+  Minimal TwoWire for building the library on a PC (see ../CMakeLists.txt).
+  There are no devices on the bus: every transmission is NACKed.
+  Use a custom VEML7700Transport to emulate a sensor.
+*/
+
+#ifndef WIRE_HOST_STUB_H
+#define WIRE_HOST_STUB_H
+
+#include <Arduino.h>
+
+class TwoWire : public Stream
+{
+public:
+  void begin() {}
+  void end() {}
+  void setClock(uint32_t) {}
+  void beginTransmission(uint8_t) {}
+  size_t write(uint8_t) { return (1); }
+  uint8_t endTransmission(bool stop = true) { (void)stop; return (2); } // Address NACK
+  uint8_t requestFrom(uint8_t, uint8_t) { return (0); }
+  uint8_t requestFrom(int address, int quantity) { return (requestFrom((uint8_t)address, (uint8_t)quantity)); }
+  int available() { return (0); }
+  int read() { return (-1); }
+};
+
+extern TwoWire Wire;
+
+#endif
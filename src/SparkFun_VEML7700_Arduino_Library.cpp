@@ -26,12 +26,45 @@
 #include "SparkFun_VEML7700_Arduino_Library.h"
 
 #define VEML7700_REGISTER_LENGTH 2 // 2 bytes per register (16-bit)
+#define VEML7700_CONFIG_RANGE_BITS 0x1BC0 // The ALS_SM and ALS_IT bits in the configuration register
+
 #define VEML7700_NUM_INTEGRATION_TIMES 6 // Number of supported integration times
 #define VEML7700_NUM_GAIN_SETTINGS 4 // Number of supported gain settings
 #define VEML7700_NUM_PERSISTENCE_PROTECT 4 // Number of supported persistence protect settings
+#define VEML7700_NUM_POWER_SAVE_MODES 4 // Number of supported power saving modes
+#define VEML7700_NUM_RANGE_CELLS 9 // Number of gain and integration time combinations used for auto-ranging
+#define VEML7700_AUTO_RANGE_LOW 100 // Default auto-range hysteresis band. Taken from the VEML7700 Application Note.
+#define VEML7700_AUTO_RANGE_HIGH 10000
+#define VEML7700_CORRECTION_THRESHOLD_LUX 1000 // The non-linearity correction is only applied above this
+#define VEML7700_CORRECTION_MAX_MILLILUX 120795955UL // The full scale: 65535 counts * 1.8432 lux. The correction is clamped to this
+#define VEML7700_POWER_ON_DELAY_ms 3 // The datasheet says to wait at least 2.5ms after ALS_SD is cleared
+#define VEML7700_SETTLING_MARGIN_PERCENT 10 // Allow for the tolerance of the internal oscillator
+#define VEML7700_BASE_RESOLUTION_x10000 36 // The finest resolution (x2, 800ms). All of the others are a power-of-two multiple
+#define VEML7700_BASE_RESOLUTION 0.0036
+#define VEML7700_UNDERRANGE_COUNTS 10 // Counts below this are under range (if a more sensitive range is available)
+#define VEML7700_CALIBRATION_UNITY_Q16 65536 // A calibration gain of 1.0 in Q16.16
+#define VEML7700_STATE_VERSION 1 // Change this if the saveState layout changes
+#define VEML7700_STATE_AUTO_RANGE 0x01 // saveState flags: auto-ranging was enabled
+#define VEML7700_DEFAULT_RETRY_BACKOFF_us 100 // The first retry back off. It doubles for each retry
+#define VEML7700_MAX_QUALITY_RETRIES 3 // Saturated: least sensitive cell, then the predicted cell. Plus one spare
+#define VEML7700_SYNCHRONOUS_BURST_MARGIN_us 2000 // Time for the ALS read and configuration write, at 100kHz
+/** Burst samples between integration restarts. With the oscillator tolerance of
+    VEML7700_SETTLING_MARGIN_PERCENT, the half period of read timing slack lasts this long */
+#define VEML7700_BURST_RESYNC_SAMPLES ((50 / VEML7700_SETTLING_MARGIN_PERCENT) > 2 ? (50 / VEML7700_SETTLING_MARGIN_PERCENT) - 2 : 1)
+#define VEML7700_ARRAY_SWEEP_MARGIN_ms 50 // sweep waits this long after the last conversion is due
+#define VEML7700_SAMPLE_GAP 0xFF // VEML7700_sample_t.range of a gap record. The real ranges are 0 to 23
+#define VEML7700_SAMPLE_MAX_GAP_TICKS 0xFFFFFFUL // The longest gap a gap record can hold (about 116 hours)
+#define VEML7700_MAX_EMA_SHIFT 6 // Keeps the EMA sum (normalized count << shift) within 32 bits
+#define VEML7700_MAX_DECIMATION 128 // Keeps the block sum within 32 bits
+#define VEML7700_FLICKER_MIN_RESPONSE 0.1 // Below this integration response, the noise would swamp the flicker
+#define VEML7700_SCHEDULER_SLEEP_LEVEL (2 + VEML7700_NUM_POWER_SAVE_MODES) // Levels 0 (fast) and 1 (normal), then the power saving modes. Shut down from here on
+#define VEML7700_SCHEDULER_MIN_SLEEP_ms 8000 // The first shut down interval: twice the longest power saving mode wait
+#define VEML7700_SCHEDULER_MAX_SLEEP_ms 60000 // The default longest shut down interval
+#define VEML7700_SCHEDULER_FLOOR_LUX 1.0 // Changes are relative to at least this, so that noise in the dark is not fast change
 
-/** The sensor resolution vs. gain and integration time. Taken from the VEML7700 Application Note. */
-const float VEML7700_LUX_RESOLUTION[VEML7700_NUM_GAIN_SETTINGS][VEML7700_NUM_INTEGRATION_TIMES] =
+/** The sensor resolution vs. gain and integration time. Taken from the VEML7700 Application Note.
+    Stored in flash (PROGMEM). Read with pgm_read_float. */
+const float VEML7700_LUX_RESOLUTION[VEML7700_NUM_GAIN_SETTINGS][VEML7700_NUM_INTEGRATION_TIMES] PROGMEM =
 {
 // 25ms    50ms    100ms   200ms   400ms   800ms
   {0.2304, 0.1152, 0.0576, 0.0288, 0.0144, 0.0072}, // Gain (sensitivity) 1
@@ -40,928 +73,5461 @@ const float VEML7700_LUX_RESOLUTION[VEML7700_NUM_GAIN_SETTINGS][VEML7700_NUM_INT
   {0.9216, 0.4608, 0.2304, 0.1152, 0.0576, 0.0288}  // Gain (sensitivity) 1/4
 };
 
-/** The VEML7700 gain (sensitivity) settings as text (string) */
-const char *VEML7700_GAIN_SETTINGS[VEML7700_NUM_GAIN_SETTINGS + 1] =
+/** The sensor resolution vs. gain and integration time, in units of 0.0001 lux per count.
+    Used by the integer (millilux) path so that it needs no floating point.
+    Stored in flash (PROGMEM). Read with pgm_read_word. */
+const uint16_t VEML7700_LUX_RESOLUTION_x10000[VEML7700_NUM_GAIN_SETTINGS][VEML7700_NUM_INTEGRATION_TIMES] PROGMEM =
+{
+// 25ms   50ms   100ms  200ms  400ms  800ms
+  {2304,  1152,  576,   288,   144,   72},  // Gain (sensitivity) 1
+  {1152,  576,   288,   144,   72,    36},  // Gain (sensitivity) 2
+  {18432, 9216,  4608,  2304,  1152,  576}, // Gain (sensitivity) 1/8
+  {9216,  4608,  2304,  1152,  576,   288}  // Gain (sensitivity) 1/4
+};
+
+/** The non-linearity correction, from the VEML7700 Application Note:
+    corrected = (6.0135e-13 * lux^4) - (9.3924e-9 * lux^3) + (8.1488e-5 * lux^2) + (1.0023 * lux)
+    This is only needed above VEML7700_CORRECTION_THRESHOLD_LUX.
+    Stored in flash (PROGMEM), like the tables below. Read with pgm_read_float, _dword, _word or _byte. */
+const float VEML7700_CORRECTION_COEFFICIENTS[4] PROGMEM = { 1.0023, 8.1488e-5, -9.3924e-9, 6.0135e-13 };
+
+/** The same coefficients for the fixed-point path. These are in Q24 format and apply
+    to the lux in kilolux, so that the intermediate values fit in 64 bits. */
+const int32_t VEML7700_CORRECTION_COEFFICIENTS_Q24[4] PROGMEM = { 16815804, 1367142, -157578, 10089 };
+
+/** The VEML7700 integration times in milliseconds, in VEML7700_integration_time_t order */
+const uint16_t VEML7700_INTEGRATION_TIMES_ms[VEML7700_NUM_INTEGRATION_TIMES] PROGMEM =
+{
+  25, 50, 100, 200, 400, 800
+};
+
+/** The power saving mode wait times in milliseconds, in VEML7700_power_save_mode_t order.
+    These are added to the integration time to give the refresh time. */
+const uint16_t VEML7700_POWER_SAVE_WAIT_ms[VEML7700_NUM_POWER_SAVE_MODES] PROGMEM =
+{
+  500, 1000, 2000, 4000
+};
+
+/** The auto-range ladder: {VEML7700_sensitivity_mode_t, VEML7700_integration_time_t}
+    in order of increasing sensitivity. The gain is stepped first, then the integration time. */
+const uint8_t VEML7700_RANGE_LADDER[VEML7700_NUM_RANGE_CELLS][2] PROGMEM =
+{
+  {VEML7700_SENSITIVITY_x1_8, VEML7700_INTEGRATION_25ms},  // 1.8432 lux/count
+  {VEML7700_SENSITIVITY_x1_4, VEML7700_INTEGRATION_25ms},  // 0.9216
+  {VEML7700_SENSITIVITY_x1,   VEML7700_INTEGRATION_25ms},  // 0.2304
+  {VEML7700_SENSITIVITY_x2,   VEML7700_INTEGRATION_25ms},  // 0.1152
+  {VEML7700_SENSITIVITY_x2,   VEML7700_INTEGRATION_50ms},  // 0.0576
+  {VEML7700_SENSITIVITY_x2,   VEML7700_INTEGRATION_100ms}, // 0.0288
+  {VEML7700_SENSITIVITY_x2,   VEML7700_INTEGRATION_200ms}, // 0.0144
+  {VEML7700_SENSITIVITY_x2,   VEML7700_INTEGRATION_400ms}, // 0.0072
+  {VEML7700_SENSITIVITY_x2,   VEML7700_INTEGRATION_800ms}  // 0.0036
+};
+
+/** Some cores do not provide pgm_read_ptr or pgm_read_float. Where flash is memory-mapped, read it directly */
+#ifndef pgm_read_ptr
+#if defined(__AVR__)
+#define pgm_read_ptr(addr) ((const void *)pgm_read_word(addr))
+#else
+#define pgm_read_ptr(addr) (*(const void * const *)(addr))
+#endif
+#endif
+#ifndef pgm_read_float
+#define pgm_read_float(addr) (*(const float *)(addr))
+#endif
+#ifndef pgm_read_dword
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#endif
+
+/** The text for the settings. These are stored in flash (PROGMEM), and shared between the tables */
+const char VEML7700_STRING_1[] PROGMEM = "1";
+const char VEML7700_STRING_2[] PROGMEM = "2";
+const char VEML7700_STRING_3[] PROGMEM = "3";
+const char VEML7700_STRING_4[] PROGMEM = "4";
+const char VEML7700_STRING_8[] PROGMEM = "8";
+const char VEML7700_STRING_x1[] PROGMEM = "x1";
+const char VEML7700_STRING_x2[] PROGMEM = "x2";
+const char VEML7700_STRING_x1_8[] PROGMEM = "x1/8";
+const char VEML7700_STRING_x1_4[] PROGMEM = "x1/4";
+const char VEML7700_STRING_25ms[] PROGMEM = "25ms";
+const char VEML7700_STRING_50ms[] PROGMEM = "50ms";
+const char VEML7700_STRING_100ms[] PROGMEM = "100ms";
+const char VEML7700_STRING_200ms[] PROGMEM = "200ms";
+const char VEML7700_STRING_400ms[] PROGMEM = "400ms";
+const char VEML7700_STRING_800ms[] PROGMEM = "800ms";
+const char VEML7700_STRING_INVALID[] PROGMEM = "INVALID";
+
+/** The VEML7700 gain (sensitivity) settings as text (string). Stored in flash (PROGMEM) */
+const char * const VEML7700_GAIN_SETTINGS[VEML7700_NUM_GAIN_SETTINGS + 1] PROGMEM =
 {
   // Note: these are in the order defined by ALS_SM and VEML7700_sensitivity_mode_t
-  "x1","x2","x1/8","x1/4","INVALID"
+  VEML7700_STRING_x1, VEML7700_STRING_x2, VEML7700_STRING_x1_8, VEML7700_STRING_x1_4, VEML7700_STRING_INVALID
 };
 
-/** The VEML7700 integration time settings as text (strting) */
-const char *VEML7700_INTEGRATION_TIMES[VEML7700_NUM_INTEGRATION_TIMES + 1] =
+/** The VEML7700 integration time settings as text (string). Stored in flash (PROGMEM) */
+const char * const VEML7700_INTEGRATION_TIMES[VEML7700_NUM_INTEGRATION_TIMES + 1] PROGMEM =
 {
   // Note: these are in ascending (VEML7700_integration_time_t) order
   //       _not_ in ALS_IT (VEML7700_config_integration_time_t) order
-  "25ms","50ms","100ms","200ms","400ms","800ms","INVALID"
+  VEML7700_STRING_25ms, VEML7700_STRING_50ms, VEML7700_STRING_100ms, VEML7700_STRING_200ms,
+  VEML7700_STRING_400ms, VEML7700_STRING_800ms, VEML7700_STRING_INVALID
+};
+
+/** The VEML7700 power saving modes as text (string). Stored in flash (PROGMEM) */
+const char * const VEML7700_POWER_SAVE_MODES[VEML7700_NUM_POWER_SAVE_MODES + 1] PROGMEM =
+{
+  VEML7700_STRING_1, VEML7700_STRING_2, VEML7700_STRING_3, VEML7700_STRING_4, VEML7700_STRING_INVALID
 };
 
-/** The VEML7700 persistence protect settings as text (string) */
-const char *VEML7700_PERSISTENCE_PROTECT_SETTINGS[VEML7700_NUM_PERSISTENCE_PROTECT + 1] =
+/** The VEML7700 persistence protect settings as text (string). Stored in flash (PROGMEM) */
+const char * const VEML7700_PERSISTENCE_PROTECT_SETTINGS[VEML7700_NUM_PERSISTENCE_PROTECT + 1] PROGMEM =
+{
+  VEML7700_STRING_1, VEML7700_STRING_2, VEML7700_STRING_4, VEML7700_STRING_8, VEML7700_STRING_INVALID
+};
+
+/** Look up the text for a setting. The result can be printed directly */
+static const __FlashStringHelper *VEML7700_flashString(const char * const *table, uint8_t index)
+{
+  return ((const __FlashStringHelper *)pgm_read_ptr(&table[index]));
+}
+
+/** The const char * API. On AVR, flash is not in the data address space, so these tables
+    hold the same text in RAM. Each setting has its own string, so the results of several calls
+    can be used together. With -fdata-sections and --gc-sections, a table is only linked when
+    its *Str() method is used. Elsewhere, flash is memory-mapped and the flash strings are returned */
+#if defined(__AVR__)
+const char * const VEML7700_GAIN_SETTINGS_RAM[VEML7700_NUM_GAIN_SETTINGS + 1] =
+{
+  "x1", "x2", "x1/8", "x1/4", "INVALID"
+};
+const char * const VEML7700_INTEGRATION_TIMES_RAM[VEML7700_NUM_INTEGRATION_TIMES + 1] =
+{
+  "25ms", "50ms", "100ms", "200ms", "400ms", "800ms", "INVALID"
+};
+const char * const VEML7700_POWER_SAVE_MODES_RAM[VEML7700_NUM_POWER_SAVE_MODES + 1] =
+{
+  "1", "2", "3", "4", "INVALID"
+};
+const char * const VEML7700_PERSISTENCE_PROTECT_SETTINGS_RAM[VEML7700_NUM_PERSISTENCE_PROTECT + 1] =
 {
   "1", "2", "4", "8", "INVALID"
 };
+#define VEML7700_ramString(flashTable, index) (flashTable##_RAM[index])
+#else
+#define VEML7700_ramString(flashTable, index) ((const char *)VEML7700_flashString(flashTable, index))
+#endif
 
-VEML7700::VEML7700()
+/** The VEML7700s using attachInterruptPin. attachInterrupt takes a plain function,
+    so each entry has its own ISR that sets the flag for that instance. */
+#ifdef ARDUINO_ISR_ATTR
+#define VEML7700_ISR_ATTR ARDUINO_ISR_ATTR
+#else
+#define VEML7700_ISR_ATTR
+#endif
+
+VEML7700 *VEML7700_INTERRUPT_INSTANCES[VEML7700_MAX_INTERRUPT_PINS] = { NULL };
+
+template <uint8_t N>
+void VEML7700_ISR_ATTR VEML7700_interruptISR()
 {
-  _i2cPort = NULL;
-  _debugPort = NULL;
-  _deviceAddress = VEML7700_I2C_ADDRESS;
-  _debugEnabled = false;
+  if (VEML7700_INTERRUPT_INSTANCES[N] != NULL)
+    VEML7700_INTERRUPT_INSTANCES[N]->interruptHandler();
 }
 
+void (*const VEML7700_INTERRUPT_ISRS[VEML7700_MAX_INTERRUPT_PINS])(void) =
+{
+  VEML7700_interruptISR<0>, VEML7700_interruptISR<1>, VEML7700_interruptISR<2>, VEML7700_interruptISR<3>
+};
+
 /**************************************************************************/
 /*!
-    @brief  Begin communication with the VEML7700
-    @param  wirePort
-            <br>The TwoWire (I2C) port used to communicate with the sensor.
-            <br>Default is Wire.
-    @return True if communication with the VEML7700 was successful, otherwise false.
+    @brief  Default asynchronous read: a blocking read, then the callback
+            <br>Override this to start a DMA or interrupt-driven read and return immediately.
+    @param  address
+            <br>The I2C address
+    @param  reg
+            <br>The register (command code)
+    @param  dest
+            <br>Where to store the data. This must stay valid until callback is called
+    @param  len
+            <br>The number of bytes to read
+    @param  callback
+            <br>Called once when the read completes (or fails)
+    @param  context
+            <br>Passed to callback unchanged
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if the read was started
 */
 /**************************************************************************/
-bool VEML7700::begin(TwoWire &wirePort)
+VEML7700_error_t VEML7700Transport::readAsync(uint8_t address, uint8_t reg, uint8_t *dest, uint8_t len,
+                                              VEML7700_transfer_callback_t callback, void *context)
 {
-  VEML7700_error_t err;
-
-  _i2cPort = &wirePort;
-
-  /** Write _configurationRegister into the VEML7700_CONFIGURATION_REGISTER.
-      This will place the device into a known state, in case it was configured previously
-      and remained powered on when the code was restarted. */
+  VEML7700_error_t err = read(address, reg, dest, len);
+  callback(err, context);
+  return (VEML7700_ERROR_SUCCESS);
+}
 
-  _configurationRegister.all = 0x0000; // Clear the reserved bits
-  _configurationRegister.CONFIG_REG_SD = VEML7700_POWER_ON;
-  _configurationRegister.CONFIG_REG_INT_EN = VEML7700_INT_DISABLE;
-  _configurationRegister.CONFIG_REG_PERS = VEML7700_PERSISTENCE_1;
-  _configurationRegister.CONFIG_REG_IT = (VEML7700_t)integrationTimeConfig(VEML7700_INTEGRATION_100ms);
-  _configurationRegister.CONFIG_REG_SM = VEML7700_SENSITIVITY_x1;
+VEML7700_error_t VEML7700TwoWireTransport::read(uint8_t address, uint8_t reg, uint8_t *dest, uint8_t len)
+{
+  _i2cPort->beginTransmission(address);
+  _i2cPort->write(reg);
+  if (_i2cPort->endTransmission(false) != 0)
+  {
+    return VEML7700_ERROR_READ;
+  }
 
-  err = writeI2CRegister(_configurationRegister.all, VEML7700_CONFIGURATION_REGISTER);
+  // Check we got all of the bytes. A short read would otherwise return garbage
+  if (_i2cPort->requestFrom(address, len) != len)
+  {
+    while (_i2cPort->available())
+      _i2cPort->read(); // Discard any partial data
+    return VEML7700_ERROR_READ;
+  }
 
-  if (_debugEnabled)
+  for (uint8_t i = 0; i < len; i++)
   {
-    _debugPort->print(F("VEML7700::begin: I2C error: "));
-    _debugPort->println(err);
+    dest[i] = _i2cPort->read();
   }
 
-  return (err == VEML7700_ERROR_SUCCESS);
+  return VEML7700_ERROR_SUCCESS;
 }
 
 /**************************************************************************/
 /*!
-    @brief  Enable debug messages on the chosen Serial port (Stream)
-    @param  debugPort
-            <br>The Serial port (Stream) the debug messages will be printed to.
-            <br>Default is Serial.
+    @brief  Free a stuck I2C bus
+            <br>If a slave was interrupted mid-byte (e.g. by a reset), it can hold SDA low.
+            <br>Clock SCL up to nine times until SDA is released, then send a STOP.
+            <br>Call this from your bus recovery callback (see VEML7700::setBusRecovery).
+            <br>The pins are left as inputs: call Wire.begin() again afterwards.
+    @param  sdaPin
+            <br>The SDA pin
+    @param  sclPin
+            <br>The SCL pin
+    @return True if SDA is high (the bus is free), otherwise false
 */
 /**************************************************************************/
-void VEML7700::enableDebugging(Stream &debugPort)
+bool VEML7700TwoWireTransport::clearBus(uint8_t sdaPin, uint8_t sclPin)
 {
-  _debugPort = &debugPort;
-  _debugEnabled = true;
+  // Drive the pins open-drain: OUTPUT LOW, or INPUT_PULLUP to release
+  pinMode(sdaPin, INPUT_PULLUP);
+  pinMode(sclPin, INPUT_PULLUP);
+  delayMicroseconds(5);
+
+  for (uint8_t i = 0; (i < 9) && (digitalRead(sdaPin) == LOW); i++)
+  {
+    pinMode(sclPin, OUTPUT);
+    digitalWrite(sclPin, LOW);
+    delayMicroseconds(5);
+    pinMode(sclPin, INPUT_PULLUP);
+    delayMicroseconds(5);
+  }
+
+  // STOP: SDA low to high while SCL is high
+  pinMode(sdaPin, OUTPUT);
+  digitalWrite(sdaPin, LOW);
+  delayMicroseconds(5);
+  pinMode(sdaPin, INPUT_PULLUP);
+  delayMicroseconds(5);
+
+  return (digitalRead(sdaPin) == HIGH);
 }
 
-/**************************************************************************/
-/*!
-    @brief  Disable debug messages
-*/
-/**************************************************************************/
-void VEML7700::disableDebugging()
+VEML7700_error_t VEML7700TwoWireTransport::write(uint8_t address, uint8_t reg, const uint8_t *src, uint8_t len)
+{
+  _i2cPort->beginTransmission(address);
+  _i2cPort->write(reg);
+  for (uint8_t i = 0; i < len; i++)
+  {
+    _i2cPort->write(src[i]);
+  }
+  if (_i2cPort->endTransmission(true) != 0)
+  {
+    return VEML7700_ERROR_WRITE;
+  }
+  return VEML7700_ERROR_SUCCESS;
+}
+
+VEML7700::VEML7700()
 {
+  _transport = NULL;
+  _asyncBusy = false;
+  _asyncAmbientCallback = NULL;
+  _asyncLuxCallback = NULL;
+  _asyncContext = NULL;
+  _highThresholdLux = -1.0;
+  _lowThresholdLux = -1.0;
+  _thresholdRange = 0;
+  _interruptPending = false;
+  _interruptPin = -1;
+  _interruptSlot = -1;
+  _highThresholdCallback = NULL;
+  _highThresholdContext = NULL;
+  _lowThresholdCallback = NULL;
+  _lowThresholdContext = NULL;
+  _windowPercent = 0;
+  _windowCallback = NULL;
+  _windowContext = NULL;
+  _busLockAcquire = NULL;
+  _busLockRelease = NULL;
+  _busLockContext = NULL;
+  _retries = 0;
+  _retryBackoffMicros = VEML7700_DEFAULT_RETRY_BACKOFF_us;
+  _busRecovery = NULL;
+  _busRecoveryContext = NULL;
+  _resetRecovery = false;
+  _resetCheckInterval = 0;
+  _lastResetCheck = 0;
+  _resetCount = 0;
+  _appliedConfiguration = 0;
+  _appliedPowerSave = 0;
+  _appliedHighThreshold = 0;
+  _appliedLowThreshold = 0;
+  _appliedRegisters = 0;
+  _calibrationGain = 1.0;
+  _calibrationOffset = 0.0;
+  _calibrationGainQ16 = VEML7700_CALIBRATION_UNITY_Q16;
+  _calibrationOffsetMilli = 0;
+  _calibrationTable = NULL;
+  _calibrationPoints = 0;
+  _calibrated = false;
+  _luxResolution = 0.0;
+  _luxResolutionValid = false;
+  _milliResolutionQ16 = 0;
+  _correctionCounts = 0xFFFF;
+  _restorePending = false;
+  _restoredConfiguration = 0;
+  _restoredPowerSave = 0;
+  _restoredHighThreshold = 0;
+  _restoredLowThreshold = 0;
+  _restoredAutoRange = false;
+#ifdef VEML7700_ENABLE_BUS_STATS
+  _asyncStartMicros = 0;
+  resetStats();
+#endif
+  _deviceAddress = VEML7700_I2C_ADDRESS;
+#ifndef VEML7700_DISABLE_DEBUG
+  _debugPort = NULL;
   _debugEnabled = false;
+#endif
+  _cacheConfiguration = false;
+  _configurationValid = false;
+  _powerSaveRegister.all = 0x0000;
+  _powerSaveValid = false;
+  _measurementActive = false;
+  _measurementPeriod = 0;
+  _nextSampleMillis = 0;
+  _saturationHandling = VEML7700_SATURATION_IGNORE;
+  _sampleQuality = VEML7700_SAMPLE_INVALID;
+  _sampleBuffer = NULL;
+  _statistics = NULL;
+  _sinkCount = 0;
+  _autoRange = false;
+  _autoRangeLow = VEML7700_AUTO_RANGE_LOW;
+  _autoRangeHigh = VEML7700_AUTO_RANGE_HIGH;
+  _autoRangeConversions = 0;
+  _lastAutoRangeConversions = 0;
 }
 
 /**************************************************************************/
 /*!
-    @brief  Check that the VEML7700 is awake and communicating.
+    @brief  Begin communication with the VEML7700
+    @param  wirePort
+            <br>The TwoWire (I2C) port used to communicate with the sensor.
+            <br>Default is Wire.
     @return True if communication with the VEML7700 was successful, otherwise false.
 */
 /**************************************************************************/
-boolean VEML7700::isConnected()
+bool VEML7700::begin(TwoWire &wirePort)
 {
-  if (_connected() != VEML7700_ERROR_SUCCESS)
-  {
-    return false;
-  }
-  return true;
+  _wireTransport.setPort(wirePort);
+  return (begin(_wireTransport));
 }
 
-VEML7700_error_t VEML7700::_connected()
+/**************************************************************************/
+/*!
+    @brief  Begin communication with the VEML7700 using a custom transport
+            <br>Use this to communicate through a DMA, interrupt-driven or RTOS I2C driver.
+    @param  transport
+            <br>The VEML7700Transport used to communicate with the sensor.
+            <br>It must remain valid for as long as the VEML7700 is used.
+    @return True if communication with the VEML7700 was successful, otherwise false.
+*/
+/**************************************************************************/
+bool VEML7700::begin(VEML7700Transport &transport)
 {
   VEML7700_error_t err;
 
-  err = readI2CRegister((VEML7700_t *)&_configurationRegister, VEML7700_CONFIGURATION_REGISTER);
+  _transport = &transport;
+  _asyncBusy = false;
 
-  if (err != VEML7700_ERROR_SUCCESS)
+  /** Write _configurationRegister into the VEML7700_CONFIGURATION_REGISTER.
+      This will place the device into a known state, in case it was configured previously
+      and remained powered on when the code was restarted. */
+
+  if (_restorePending)
   {
-    if (_debugEnabled)
+    // Come up straight in the saved configuration and range (see restoreState)
+    err = applyRestoredState();
+  }
+  else
+  {
+    VEML7700_config_t config;
+    config.shutdown = VEML7700_POWER_ON;
+    config.interruptEnable = VEML7700_INT_DISABLE;
+    config.persistenceProtect = VEML7700_PERSISTENCE_1;
+    config.integrationTime = VEML7700_INTEGRATION_100ms;
+    config.sensitivityMode = VEML7700_SENSITIVITY_x1;
+
+    err = applyConfiguration(config);
+
+    /** The power saving mode register also keeps its setting while the sensor stays powered.
+        Disable power saving mode. */
+    if (err == VEML7700_ERROR_SUCCESS)
     {
-  		_debugPort->print(F("VEML7700::_connected: error: "));
-      _debugPort->println(err);
+      _powerSaveRegister.all = 0x0000; // Clear the reserved bits. PSM_EN = 0. PSM = mode 1.
+      err = writePowerSaveRegister();
     }
-    return err;
   }
 
-  if (_debugEnabled) _debugPort->println("VEML7700::_connected: success!");
+#ifndef VEML7700_DISABLE_DEBUG
+  if (_debugEnabled)
+  {
+    _debugPort->print(F("VEML7700::begin: I2C error: "));
+    _debugPort->println(err);
+  }
+#endif
 
-  return VEML7700_ERROR_SUCCESS;
+  return (err == VEML7700_ERROR_SUCCESS);
 }
 
-/**************************************************************************/
-/*!
-    @brief  Set the VEML7700's shut down setting (ALS_SD)
-    @param  sd
-            <br>The shut down setting. Possible values are:
-            <br>VEML7700_POWER_ON
-            <br>VEML7700_SHUT_DOWN
-    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
-*/
-/**************************************************************************/
-VEML7700_error_t VEML7700::setShutdown(VEML7700_shutdown_t sd)
+bool VEML7700::beginFixed(TwoWire &wirePort, VEML7700_t configuration)
+{
+  _wireTransport.setPort(wirePort);
+  return (beginFixed(_wireTransport, configuration));
+}
+
+bool VEML7700::beginFixed(VEML7700Transport &transport, VEML7700_t configuration)
 {
   VEML7700_error_t err;
 
-  err = readI2CRegister((VEML7700_t *)&_configurationRegister, VEML7700_CONFIGURATION_REGISTER);
-  if (err != VEML7700_ERROR_SUCCESS)
+  _transport = &transport;
+  _asyncBusy = false;
+
+  // The configuration never changes, so the shadow copy can always be trusted
+  _cacheConfiguration = true;
+
+  _configurationRegister.all = configuration;
+  err = writeConfigurationRegister();
+
+  if (err == VEML7700_ERROR_SUCCESS)
   {
-    return err;
+    _powerSaveRegister.all = 0x0000; // Disable power saving mode
+    err = writePowerSaveRegister();
   }
 
-  _configurationRegister.CONFIG_REG_SD = (VEML7700_t)sd;
-
-  return writeI2CRegister(_configurationRegister.all, VEML7700_CONFIGURATION_REGISTER);
+  return (err == VEML7700_ERROR_SUCCESS);
 }
 
-/**************************************************************************/
-/*!
-    @brief  Get the VEML7700's shut down setting (ALS_SD)
-    @return VEML7700_POWER_ON or VEML7700_SHUT_DOWN if successful, VEML7700_SHUTDOWN_INVALID otherwise
-*/
-/**************************************************************************/
-VEML7700_shutdown_t VEML7700::getShutdown()
+VEML7700_error_t VEML7700::readFixedAmbient(uint16_t *ambient)
 {
   VEML7700_error_t err;
 
-  err = readI2CRegister((VEML7700_t *)&_configurationRegister, VEML7700_CONFIGURATION_REGISTER);
+  err = getAmbientLight(ambient);
+
   if (err != VEML7700_ERROR_SUCCESS)
-  {
-    return VEML7700_SHUTDOWN_INVALID;
-  }
+    return (err);
 
-  return ((VEML7700_shutdown_t)_configurationRegister.CONFIG_REG_SD);
+  // Don't let checkSampleQuality change the range
+  VEML7700_saturation_handling_t handling = _saturationHandling;
+
+  if (_saturationHandling == VEML7700_SATURATION_RETRY)
+    _saturationHandling = VEML7700_SATURATION_REPORT;
+
+  err = checkSampleQuality(ambient, false);
+
+  _saturationHandling = handling;
+
+  return (err);
 }
 
 /**************************************************************************/
 /*!
-    @brief  Set the VEML7700's interrupt enable setting (ALS_INT_EN)
-    @param  ie
-            <br>The interrupt enable setting. Possible values are:
-            <br>VEML7700_INT_DISABLE
-            <br>VEML7700_INT_ENABLE
+    @brief  Save a snapshot of the sensor state, for a fast warm start
+            <br>The snapshot holds the configuration (gain, integration time, persistence and
+            <br>interrupt enable), power saving mode, thresholds, auto-range enable and the calibration.
+            <br>It is VEML7700_STATE_SIZE bytes with a fixed little-endian layout and a checksum, so it
+            <br>can be written straight to EEPROM, NVS or flash. Pass it to restoreState after a reset.
+            <br>With the configuration cache enabled only the thresholds may need to be read.
+            <br>Byte layout:
+            <br>0: VEML7700_STATE_VERSION
+            <br>1: flags (bit 0: auto-range enabled)
+            <br>2-3: configuration register
+            <br>4-5: power saving mode register
+            <br>6-7: high threshold register
+            <br>8-9: low threshold register
+            <br>10-13: calibration gain, unsigned Q16.16
+            <br>14-17: calibration offset, signed millilux
+            <br>18-19: Fletcher-16 checksum of bytes 0-17
+    @param  state
+            <br>Storage for VEML7700_STATE_SIZE bytes
+    @param  length
+            <br>The size of state. Must be at least VEML7700_STATE_SIZE
     @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
 */
 /**************************************************************************/
-VEML7700_error_t VEML7700::setInterruptEnable(VEML7700_interrupt_enable_t ie)
+VEML7700_error_t VEML7700::saveState(uint8_t *state, uint16_t length)
 {
   VEML7700_error_t err;
+  VEML7700_t highThreshold = _appliedHighThreshold;
+  VEML7700_t lowThreshold = _appliedLowThreshold;
+
+  if ((state == NULL) || (length < VEML7700_STATE_SIZE))
+    return (VEML7700_ERROR_UNDEFINED);
+
+  err = readConfigurationRegister(); // Does nothing if the shadow is valid
+  if (err == VEML7700_ERROR_SUCCESS)
+    err = readPowerSaveRegister();
+
+  // Only read the thresholds if we have not written them
+  if ((err == VEML7700_ERROR_SUCCESS) && !(_appliedRegisters & (1 << VEML7700_HIGH_THRESHOLD)))
+    err = readI2CRegister(&highThreshold, VEML7700_HIGH_THRESHOLD);
+  if ((err == VEML7700_ERROR_SUCCESS) && !(_appliedRegisters & (1 << VEML7700_LOW_THRESHOLD)))
+    err = readI2CRegister(&lowThreshold, VEML7700_LOW_THRESHOLD);
 
-  err = readI2CRegister((VEML7700_t *)&_configurationRegister, VEML7700_CONFIGURATION_REGISTER);
   if (err != VEML7700_ERROR_SUCCESS)
-  {
-    return err;
-  }
+    return (err);
 
-  _configurationRegister.CONFIG_REG_INT_EN = (VEML7700_t)ie;
+  state[0] = VEML7700_STATE_VERSION;
+  state[1] = _autoRange ? VEML7700_STATE_AUTO_RANGE : 0;
+  storeState(&state[2], _configurationRegister.all, 2);
+  storeState(&state[4], _powerSaveRegister.all, 2);
+  storeState(&state[6], highThreshold, 2);
+  storeState(&state[8], lowThreshold, 2);
+  storeState(&state[10], _calibrationGainQ16, 4);
+  storeState(&state[14], (uint32_t)_calibrationOffsetMilli, 4);
+  storeState(&state[18], stateChecksum(state, VEML7700_STATE_SIZE - 2), 2);
 
-  return writeI2CRegister(_configurationRegister.all, VEML7700_CONFIGURATION_REGISTER);
+  return (VEML7700_ERROR_SUCCESS);
 }
 
 /**************************************************************************/
 /*!
-    @brief  Get the VEML7700's interrupt enable setting (ALS_INT_EN)
-    @param  ie
-            <br>Will be set to the interrupt enable setting on return
+    @brief  Restore a snapshot saved by saveState
+            <br>Call this before begin: begin then comes up straight in the saved range,
+            <br>instead of the default configuration. If begin has already been called,
+            <br>the snapshot is written to the sensor now.
+            <br>The calibration is restored immediately. The sensor is always powered on.
+            <br>Lux thresholds (setHighThresholdLux / setLowThresholdLux) are restored as
+            <br>raw thresholds, for the saved range.
+    @param  state
+            <br>The snapshot
+    @param  length
+            <br>The size of state. Must be at least VEML7700_STATE_SIZE
     @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+            <br>VEML7700_ERROR_UNDEFINED if the checksum, version or configuration is invalid
+            <br>(e.g. the EEPROM has never been written). The snapshot is then ignored.
 */
 /**************************************************************************/
-VEML7700_error_t VEML7700::getInterruptEnable(VEML7700_interrupt_enable_t *ie)
+VEML7700_error_t VEML7700::restoreState(const uint8_t *state, uint16_t length)
+{
+  if ((state == NULL) || (length < VEML7700_STATE_SIZE)
+      || (loadState(&state[18], 2) != stateChecksum(state, VEML7700_STATE_SIZE - 2))
+      || (state[0] != VEML7700_STATE_VERSION))
+    return (VEML7700_ERROR_UNDEFINED);
+
+  VEML7700_CONFIGURATION_REGISTER_t config;
+  config.all = (VEML7700_t)loadState(&state[2], 2);
+
+  if ((config.CONFIG_REG_SM >= VEML7700_SENSITIVITY_INVALID)
+      || (integrationTimeFromConfig((VEML7700_config_integration_time_t)config.CONFIG_REG_IT) >= VEML7700_INTEGRATION_INVALID))
+    return (VEML7700_ERROR_UNDEFINED);
+
+  config.CONFIG_REG_SD = VEML7700_POWER_ON;
+  _restoredConfiguration = config.all;
+  _restoredPowerSave = (VEML7700_t)loadState(&state[4], 2);
+  _restoredHighThreshold = (VEML7700_t)loadState(&state[6], 2);
+  _restoredLowThreshold = (VEML7700_t)loadState(&state[8], 2);
+  _restoredAutoRange = ((state[1] & VEML7700_STATE_AUTO_RANGE) != 0);
+
+  _calibrationGainQ16 = loadState(&state[10], 4);
+  _calibrationOffsetMilli = (int32_t)loadState(&state[14], 4);
+  _calibrationGain = (float)_calibrationGainQ16 / (float)VEML7700_CALIBRATION_UNITY_Q16;
+  _calibrationOffset = (float)_calibrationOffsetMilli / 1000.0;
+  updateResolution();
+
+  _restorePending = true;
+
+  if (_transport == NULL)
+    return (VEML7700_ERROR_SUCCESS); // begin will apply it
+
+  return (applyRestoredState());
+}
+
+VEML7700_error_t VEML7700::applyRestoredState()
 {
   VEML7700_error_t err;
 
-  err = readI2CRegister((VEML7700_t *)&_configurationRegister, VEML7700_CONFIGURATION_REGISTER);
-  
+  _restorePending = false;
+
+  // Cancel any lux thresholds: the raw thresholds are for the saved range
+  _highThresholdLux = -1.0;
+  _lowThresholdLux = -1.0;
+
+  // The thresholds and power saving mode first. The configuration write then starts the integration
+  err = writeI2CRegister(_restoredHighThreshold, VEML7700_HIGH_THRESHOLD);
+  if (err == VEML7700_ERROR_SUCCESS)
+    err = writeI2CRegister(_restoredLowThreshold, VEML7700_LOW_THRESHOLD);
   if (err == VEML7700_ERROR_SUCCESS)
   {
-    *ie = (VEML7700_interrupt_enable_t)_configurationRegister.CONFIG_REG_INT_EN;
+    _powerSaveRegister.all = _restoredPowerSave;
+    err = writePowerSaveRegister();
   }
-  else
+  if (err == VEML7700_ERROR_SUCCESS)
   {
-    *ie = VEML7700_INT_INVALID;
+    _configurationRegister.all = _restoredConfiguration;
+    err = writeConfigurationRegister();
   }
 
+  if (err == VEML7700_ERROR_SUCCESS)
+    _autoRange = _restoredAutoRange;
+
   return (err);
 }
 
-/**************************************************************************/
-/*!
-    @brief  Get the VEML7700's interrupt enable setting (ALS_INT_EN)
-    @return  VEML7700_INT_DISABLE or VEML7700_INT_ENABLE if successful, VEML7700_INT_INVALID otherwise
-*/
-/**************************************************************************/
-VEML7700_interrupt_enable_t VEML7700::getInterruptEnable()
+void VEML7700::storeState(uint8_t *dest, uint32_t value, uint8_t len)
 {
-  VEML7700_error_t err;
+  for (uint8_t i = 0; i < len; i++)
+    dest[i] = (uint8_t)(value >> (8 * i));
+}
 
-  err = readI2CRegister((VEML7700_t *)&_configurationRegister, VEML7700_CONFIGURATION_REGISTER);
-  if (err != VEML7700_ERROR_SUCCESS)
+uint32_t VEML7700::loadState(const uint8_t *src, uint8_t len)
+{
+  uint32_t value = 0;
+  for (uint8_t i = 0; i < len; i++)
+    value |= ((uint32_t)src[i]) << (8 * i);
+  return (value);
+}
+
+uint16_t VEML7700::stateChecksum(const uint8_t *state, uint8_t len)
+{
+  // Fletcher-16. Unlike a plain sum, this catches swapped bytes. Erased flash (all 0xFF) fails
+  uint16_t sum1 = 0;
+  uint16_t sum2 = 0;
+  for (uint8_t i = 0; i < len; i++)
   {
-    return VEML7700_INT_INVALID;
+    sum1 = (sum1 + state[i]) % 255;
+    sum2 = (sum2 + sum1) % 255;
   }
-
-  return ((VEML7700_interrupt_enable_t)_configurationRegister.CONFIG_REG_INT_EN);
+  return ((sum2 << 8) | sum1);
 }
 
 /**************************************************************************/
 /*!
-    @brief  Set the VEML7700's persistence protect number setting (ALS_PERS)
-    @param  pp
-            <br>The persistence protect setting. Possible values are:
-            <br>VEML7700_PERSISTENCE_1
-            <br>VEML7700_PERSISTENCE_2
-            <br>VEML7700_PERSISTENCE_4
-            <br>VEML7700_PERSISTENCE_8
+    @brief  Set the per-unit calibration
+            <br>lux = (the datasheet lux * gain) + offset. Find them by comparing this unit with a
+            <br>reference lux meter. The non-linearity correction (getLuxCorrected) is a property of the
+            <br>sensor, so it is applied to the datasheet lux first, then the calibration.
+            <br>The calibration is applied to all VEML7700 lux reads and lux thresholds. It is not
+            <br>applied to VEML7700SampleBuffer or VEML7700Statistics, which hold raw counts.
+            <br>The gain is folded into the resolution whenever the gain or integration time changes,
+            <br>so the calibrated lux is still a single multiply-add.
+            <br>It is included in saveState.
+    @param  gain
+            <br>The calibration gain. Must be greater than zero and less than 65536. Default is 1.0
+    @param  offset
+            <br>The calibration offset in lux. Default is 0.0
     @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+            <br>VEML7700_ERROR_UNDEFINED if the gain is out of range
 */
 /**************************************************************************/
-VEML7700_error_t VEML7700::setPersistenceProtect(VEML7700_persistence_protect_t pp)
+VEML7700_error_t VEML7700::setCalibration(float gain, float offset)
 {
-  VEML7700_error_t err;
+  if ((gain <= 0.0) || (gain >= 65536.0) || (offset <= -2147483.0) || (offset >= 2147483.0))
+    return (VEML7700_ERROR_UNDEFINED);
 
-  err = readI2CRegister((VEML7700_t *)&_configurationRegister, VEML7700_CONFIGURATION_REGISTER);
-  if (err != VEML7700_ERROR_SUCCESS)
-  {
-    return err;
-  }
+  // Hold the Q forms for the integer (millilux) path and saveState, and round the floats to match
+  _calibrationGainQ16 = (uint32_t)((gain * (float)VEML7700_CALIBRATION_UNITY_Q16) + 0.5);
+  if (_calibrationGainQ16 == 0)
+    _calibrationGainQ16 = 1;
+  _calibrationOffsetMilli = (int32_t)((offset * 1000.0) + ((offset < 0.0) ? -0.5 : 0.5));
+  _calibrationGain = (float)_calibrationGainQ16 / (float)VEML7700_CALIBRATION_UNITY_Q16;
+  _calibrationOffset = (float)_calibrationOffsetMilli / 1000.0;
 
-  _configurationRegister.CONFIG_REG_PERS = (VEML7700_t)pp;
+  updateResolution();
 
-  return writeI2CRegister(_configurationRegister.all, VEML7700_CONFIGURATION_REGISTER);
+  return (VEML7700_ERROR_SUCCESS);
 }
 
 /**************************************************************************/
 /*!
-    @brief  Get the VEML7700's persistence protect number setting (ALS_PERS)
-    @param  pp
-            <br>Will be set to the persistence protect number on return
+    @brief  Set a piecewise-linear calibration table
+            <br>Use this with an enclosure window whose response is not flat: e.g. a diffuser
+            <br>which is less efficient at high light levels. The table maps the lux (after the
+            <br>calibration gain and offset) to the calibrated lux. Between points, the lux is
+            <br>interpolated. Beyond the ends, the first and last segments are extended.
+            <br>The segment slopes and intercepts are calculated here, so each lux read is one
+            <br>segment search and one extra multiply-add.
+            <br>The table is not copied: it must remain valid while it is in use.
+            <br>The table is not included in saveState.
+    @param  table
+            <br>The points, in increasing order of lux and of calibratedLux. NULL to remove the table
+    @param  points
+            <br>The number of points: 2 to VEML7700_MAX_CALIBRATION_POINTS. 0 to remove the table
     @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+            <br>VEML7700_ERROR_UNDEFINED if the table is invalid. The table is not changed
 */
 /**************************************************************************/
-VEML7700_error_t VEML7700::getPersistenceProtect(VEML7700_persistence_protect_t *pp)
+VEML7700_error_t VEML7700::setCalibrationTable(const VEML7700_calibration_point_t *table, uint8_t points)
 {
-  VEML7700_error_t err;
-
-  err = readI2CRegister((VEML7700_t *)&_configurationRegister, VEML7700_CONFIGURATION_REGISTER);
-  
-  if (err == VEML7700_ERROR_SUCCESS)
+  if ((table == NULL) || (points == 0))
   {
-    *pp = (VEML7700_persistence_protect_t)_configurationRegister.CONFIG_REG_PERS;
-  }
-  else
-  {
-    *pp = VEML7700_PERSISTENCE_INVALID;
+    _calibrationTable = NULL;
+    _calibrationPoints = 0;
+    updateResolution();
+    return (VEML7700_ERROR_SUCCESS);
   }
 
-  return (err);
-}
+  if ((points < 2) || (points > VEML7700_MAX_CALIBRATION_POINTS))
+    return (VEML7700_ERROR_UNDEFINED);
 
-/**************************************************************************/
-/*!
-    @brief  Get the VEML7700's persistence protect number setting (ALS_PERS)
-    @return If successful:
-            <br>VEML7700_PERSISTENCE_1
-            <br>VEML7700_PERSISTENCE_2
-            <br>VEML7700_PERSISTENCE_4
-            <br>VEML7700_PERSISTENCE_8
-            <br>Otherwise:
-            <br>VEML7700_PERSISTENCE_INVALID
-*/
-/**************************************************************************/
-VEML7700_persistence_protect_t VEML7700::getPersistenceProtect()
-{
-  VEML7700_error_t err;
+  // Both must be strictly increasing, so the table can be inverted for the lux thresholds
+  for (uint8_t i = 1; i < points; i++)
+    if ((table[i].lux <= table[i - 1].lux) || (table[i].calibratedLux <= table[i - 1].calibratedLux))
+      return (VEML7700_ERROR_UNDEFINED);
 
-  err = readI2CRegister((VEML7700_t *)&_configurationRegister, VEML7700_CONFIGURATION_REGISTER);
-  if (err != VEML7700_ERROR_SUCCESS)
+  /** Segment n, from point n to point n + 1, is calibrated = intercept[n] + (lux * slope[n]).
+      The first and last segments are extended beyond the ends of the table.
+      The table is in lux, so this does not depend on the gain or integration time. */
+  for (uint8_t segment = 0; (segment + 1) < points; segment++)
   {
-    return VEML7700_PERSISTENCE_INVALID;
+    const VEML7700_calibration_point_t *p = &table[segment];
+    float slope = (p[1].calibratedLux - p[0].calibratedLux) / (p[1].lux - p[0].lux);
+    float intercept = p[0].calibratedLux - (slope * p[0].lux);
+
+    _tableSlope[segment] = slope;
+    _tableIntercept[segment] = intercept;
+
+    float slopeQ16 = slope * 65536.0;
+    _tableSlopeQ16[segment] = (slopeQ16 >= 2147483647.0) ? 2147483647 : (int32_t)(slopeQ16 + 0.5);
+    float interceptMilli = intercept * 1000.0;
+    _tableInterceptMilli[segment] = (interceptMilli >= 2147483647.0) ? 2147483647 : (interceptMilli <= -2147483647.0) ? -2147483647 : (int32_t)interceptMilli;
+
+    // The millilux at which the next segment starts
+    if ((segment + 2) < points)
+    {
+      float breakMilli = p[1].lux * 1000.0;
+      _tableBreakMilli[segment] = (breakMilli >= 2147483647.0) ? 2147483647 : (breakMilli <= -2147483647.0) ? -2147483647 : (int32_t)breakMilli;
+    }
   }
 
-  return ((VEML7700_persistence_protect_t)_configurationRegister.CONFIG_REG_PERS);
+  _calibrationTable = table;
+  _calibrationPoints = points;
+  updateResolution();
+
+  return (VEML7700_ERROR_SUCCESS);
 }
 
 /**************************************************************************/
 /*!
-    @brief  Get the VEML7700's persistence protect number setting (ALS_PERS) as printable text
+    @brief  Get the per-unit calibration
+    @param  gain
+            <br>Will be set to the calibration gain on return
+    @param  offset
+            <br>Will be set to the calibration offset in lux on return
 */
 /**************************************************************************/
-const char * VEML7700::getPersistenceProtectStr()
+void VEML7700::getCalibration(float *gain, float *offset)
 {
-  VEML7700_persistence_protect_t pp;
-
-  getPersistenceProtect(&pp);
-
-  return (VEML7700_PERSISTENCE_PROTECT_SETTINGS[pp]);
+  *gain = _calibrationGain;
+  *offset = _calibrationOffset;
 }
 
 /**************************************************************************/
 /*!
-    @brief  Set the VEML7700's integration time setting (ALS_IT)
-            <br>Note: these are defined here in simple sequential order
-            <br>The actual register settings are defined in VEML7700_config_integration_time_t
-    @param  it
-            <br>The integration time setting. Possible values are:
-            <br>VEML7700_INTEGRATION_25ms
-            <br>VEML7700_INTEGRATION_50ms
-            <br>VEML7700_INTEGRATION_100ms
-            <br>VEML7700_INTEGRATION_200ms
-            <br>VEML7700_INTEGRATION_400ms
-            <br>VEML7700_INTEGRATION_800ms
-    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+    @brief  Set the number of times a failed I2C transaction is retried
+            <br>Only bus errors (VEML7700_ERROR_READ / VEML7700_ERROR_WRITE) are retried.
+            <br>The default is no retries.
+    @param  retries
+            <br>The number of retries (0 to disable)
+    @param  backoffMicros
+            <br>The delay before the first retry. It doubles for each retry. Default is 100us
 */
 /**************************************************************************/
-VEML7700_error_t VEML7700::setIntegrationTime(VEML7700_integration_time_t it)
+void VEML7700::setRetries(uint8_t retries, unsigned int backoffMicros)
 {
-  VEML7700_error_t err;
-
-  err = readI2CRegister((VEML7700_t *)&_configurationRegister, VEML7700_CONFIGURATION_REGISTER);
-  if (err != VEML7700_ERROR_SUCCESS)
-  {
-    return err;
-  }
-
-  _configurationRegister.CONFIG_REG_IT = (VEML7700_t)integrationTimeConfig(it);
-
-  return writeI2CRegister(_configurationRegister.all, VEML7700_CONFIGURATION_REGISTER);
+  _retries = retries;
+  _retryBackoffMicros = backoffMicros;
 }
 
 /**************************************************************************/
 /*!
-    @brief  Get the VEML7700's integration time setting (ALS_IT)
-    @param  it
-            <br>Will be set to the intergration time setting on return
-    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+    @brief  Set the bus recovery callback
+            <br>Called before the second and any later retries of a transaction (after two
+            <br>failures in a row), with the bus lock held. Use it to free a stuck bus,
+            <br>e.g. with VEML7700TwoWireTransport::clearBus and Wire.begin().
+            <br>Needs at least two retries (see setRetries).
+    @param  recovery
+            <br>The callback. NULL to remove it
+    @param  context
+            <br>Passed to recovery unchanged
 */
 /**************************************************************************/
-VEML7700_error_t VEML7700::getIntegrationTime(VEML7700_integration_time_t *it)
+void VEML7700::setBusRecovery(VEML7700_bus_recovery_t recovery, void *context)
 {
-  VEML7700_error_t err;
-
-  err = readI2CRegister((VEML7700_t *)&_configurationRegister, VEML7700_CONFIGURATION_REGISTER);
-
-  if (err == VEML7700_ERROR_SUCCESS)
-  {
-    *it = (VEML7700_integration_time_t)integrationTimeFromConfig((VEML7700_config_integration_time_t)_configurationRegister.CONFIG_REG_IT);
-  }
-  else
-  {
-    *it = VEML7700_INTEGRATION_INVALID;
-  }
-
-  return (err);
+  _busRecovery = recovery;
+  _busRecoveryContext = context;
 }
 
 /**************************************************************************/
 /*!
-    @brief  Get the VEML7700's integration time setting (ALS_IT)
-    @return If successful:
-            <br>VEML7700_INTEGRATION_25ms
-            <br>VEML7700_INTEGRATION_50ms
-            <br>VEML7700_INTEGRATION_100ms
-            <br>VEML7700_INTEGRATION_200ms
-            <br>VEML7700_INTEGRATION_400ms
-            <br>VEML7700_INTEGRATION_800ms
-            <br>Otherwise:
-            <br>VEML7700_INTEGRATION_INVALID
+    @brief  Enable recovery from unexpected sensor resets (e.g. a brown-out)
+            <br>After a reset, the sensor is back in its default (shut down) configuration.
+            <br>Each time the configuration register is read, it is compared with the value
+            <br>last written. If they differ, the configuration, power saving mode and
+            <br>thresholds last written are restored. getResetCount counts the recoveries.
+            <br>With the configuration cache enabled, the register is not normally read.
+            <br>Use checkIntervalMillis to have poll check it regularly, or call checkConfiguration.
+    @param  checkIntervalMillis
+            <br>How often poll checks the configuration (ms). 0 (default) to not check in poll
 */
 /**************************************************************************/
-VEML7700_integration_time_t VEML7700::getIntegrationTime()
+void VEML7700::enableResetRecovery(unsigned long checkIntervalMillis)
 {
-  VEML7700_error_t err;
-
-  err = readI2CRegister((VEML7700_t *)&_configurationRegister, VEML7700_CONFIGURATION_REGISTER);
-  if (err != VEML7700_ERROR_SUCCESS)
-  {
-    return VEML7700_INTEGRATION_INVALID;
-  }
-
-  return ((VEML7700_integration_time_t)integrationTimeFromConfig((VEML7700_config_integration_time_t)_configurationRegister.CONFIG_REG_IT));
+  _resetRecovery = true;
+  _resetCheckInterval = checkIntervalMillis;
+  _lastResetCheck = millis();
 }
 
 /**************************************************************************/
 /*!
-    @brief  Get the VEML7700's integration time setting (ALS_IT) as printable text
+    @brief  Disable recovery from unexpected sensor resets
 */
 /**************************************************************************/
-const char * VEML7700::getIntegrationTimeStr()
+void VEML7700::disableResetRecovery()
 {
-  VEML7700_integration_time_t it;
-
-  getIntegrationTime(&it);
-
-  return (VEML7700_INTEGRATION_TIMES[it]);
+  _resetRecovery = false;
 }
 
 /**************************************************************************/
 /*!
-    @brief  Set the VEML7700's sensitivity mode selection (ALS_SM)
-    @param  it
-            <br>The sensitivity mode selection. Possible values are:
-            <br>VEML7700_SENSITIVITY_x1
-            <br>VEML7700_SENSITIVITY_x2
-            <br>VEML7700_SENSITIVITY_x1_8
-            <br>VEML7700_SENSITIVITY_x1_4
-    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+    @brief  Check for an unexpected sensor reset
+            <br>Reads the configuration register and compares it with the value last written.
+            <br>If they differ, the configuration, power saving mode and thresholds last written are restored.
+            <br>This always reads the register, even if the configuration cache is enabled.
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful (including a successful restore)
 */
 /**************************************************************************/
-VEML7700_error_t VEML7700::setSensitivityMode(VEML7700_sensitivity_mode_t sm)
+VEML7700_error_t VEML7700::checkConfiguration()
 {
-  VEML7700_error_t err;
+  VEML7700_t value;
+  VEML7700_error_t err = readI2CRegister(&value, VEML7700_CONFIGURATION_REGISTER);
 
-  err = readI2CRegister((VEML7700_t *)&_configurationRegister, VEML7700_CONFIGURATION_REGISTER);
   if (err != VEML7700_ERROR_SUCCESS)
   {
-    return err;
+    _configurationValid = false;
+    return (err);
   }
 
-  _configurationRegister.CONFIG_REG_SM = (VEML7700_t)sm;
+  _lastResetCheck = millis();
+
+  if ((_appliedRegisters & (1 << VEML7700_CONFIGURATION_REGISTER)) && (value != _appliedConfiguration))
+    return (restoreConfiguration());
 
-  return writeI2CRegister(_configurationRegister.all, VEML7700_CONFIGURATION_REGISTER);
+  _configurationRegister.all = value;
+  _configurationValid = true;
+  updateResolution();
+
+  return (VEML7700_ERROR_SUCCESS);
 }
 
 /**************************************************************************/
 /*!
-    @brief  Get the VEML7700's sensitivity mode selection (ALS_SM)
-    @param  sm
-            <br>Will be set to the sensitivity mode selection on return
-    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+    @brief  Set the bus lock used to share the I2C bus between RTOS tasks
+            <br>acquire is called before, and release after, each register transaction
+            <br>(the command code write, repeated start and data read are one transaction).
+            <br>By default there is no lock. Pass NULL for acquire and release to remove it.
+            <br>For asynchronous reads, release is called from the completion callback,
+            <br>which may be interrupt context with some transports.
+    @param  acquire
+            <br>Take the lock. Return false if it could not be taken: the transaction
+            <br>then fails with VEML7700_ERROR_BUSY
+    @param  release
+            <br>Give the lock back
+    @param  context
+            <br>Passed to acquire and release unchanged (e.g. the SemaphoreHandle_t)
 */
 /**************************************************************************/
-VEML7700_error_t VEML7700::getSensitivityMode(VEML7700_sensitivity_mode_t *sm)
+void VEML7700::setBusLock(VEML7700_lock_acquire_t acquire, VEML7700_lock_release_t release, void *context)
 {
-  VEML7700_error_t err;
-
-  err = readI2CRegister((VEML7700_t *)&_configurationRegister, VEML7700_CONFIGURATION_REGISTER);
-  
-  if (err == VEML7700_ERROR_SUCCESS)
-  {
-    *sm = (VEML7700_sensitivity_mode_t)_configurationRegister.CONFIG_REG_SM;
-  }
-  else
-  {
-    *sm = VEML7700_SENSITIVITY_INVALID;
-  }
-
-  return (err);
+  _busLockAcquire = acquire;
+  _busLockRelease = release;
+  _busLockContext = context;
 }
 
 /**************************************************************************/
 /*!
-    @brief  Get the VEML7700's sensitivity mode selection (ALS_SM)
-    @return If successful:
-            <br>VEML7700_SENSITIVITY_x1
-            <br>VEML7700_SENSITIVITY_x2
-            <br>VEML7700_SENSITIVITY_x1_8
-            <br>VEML7700_SENSITIVITY_x1_4
-            <br>Otherwise:
-            <br>VEML7700_SENSITIVITY_INVALID
+    @brief  Get the I2C bus statistics
+            <br>Only available if VEML7700_ENABLE_BUS_STATS is defined
+    @param  stats
+            <br>Will be set to the statistics since begin or resetStats on return
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+            <br>VEML7700_ERROR_UNDEFINED if VEML7700_ENABLE_BUS_STATS is not defined
 */
 /**************************************************************************/
-VEML7700_sensitivity_mode_t VEML7700::getSensitivityMode()
+VEML7700_error_t VEML7700::getStats(VEML7700_bus_stats_t *stats)
 {
-  VEML7700_error_t err;
+#ifdef VEML7700_ENABLE_BUS_STATS
+  *stats = _stats;
 
-  err = readI2CRegister((VEML7700_t *)&_configurationRegister, VEML7700_CONFIGURATION_REGISTER);
-  if (err != VEML7700_ERROR_SUCCESS)
-  {
-    return VEML7700_SENSITIVITY_INVALID;
-  }
+  uint32_t transactions = _stats.reads + _stats.writes;
+  stats->averageMicros = (transactions == 0) ? 0 : (_totalMicros + (transactions / 2)) / transactions;
+  if (transactions == 0)
+    stats->minMicros = 0;
 
-  return ((VEML7700_sensitivity_mode_t)_configurationRegister.CONFIG_REG_SM);
+  return (VEML7700_ERROR_SUCCESS);
+#else
+  (void)stats; // Bus statistics are compiled out
+  return (VEML7700_ERROR_UNDEFINED);
+#endif
 }
 
 /**************************************************************************/
 /*!
-    @brief  Get the VEML7700's sensitivity mode selection (ALS_SM) as printable text
+    @brief  Reset the I2C bus statistics
+            <br>Does nothing if VEML7700_ENABLE_BUS_STATS is not defined
 */
 /**************************************************************************/
-const char * VEML7700::getSensitivityModeStr()
+void VEML7700::resetStats()
 {
-  VEML7700_sensitivity_mode_t sm;
-
-  getSensitivityMode(&sm);
-
-  return (VEML7700_GAIN_SETTINGS[sm]);
+#ifdef VEML7700_ENABLE_BUS_STATS
+  memset(&_stats, 0, sizeof(_stats));
+  _stats.minMicros = 0xFFFFFFFF;
+  _totalMicros = 0;
+#endif
 }
 
 /**************************************************************************/
 /*!
-    @brief  Set the VEML7700's ALS high threshold window setting (ALS_WH)
-    @param  threshold
-            <br>The threshold setting: 0x0000 to 0xFFFF
-    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+    @brief  Enable debug messages on the chosen Serial port (Stream)
+            <br>Does nothing if VEML7700_DISABLE_DEBUG is defined
+    @param  debugPort
+            <br>The Serial port (Stream) the debug messages will be printed to.
+            <br>Default is Serial.
 */
 /**************************************************************************/
-VEML7700_error_t VEML7700::setHighThreshold(uint16_t threshold)
+void VEML7700::enableDebugging(Stream &debugPort)
 {
-  return (writeI2CRegister((VEML7700_t)threshold, VEML7700_HIGH_THRESHOLD));
+#ifndef VEML7700_DISABLE_DEBUG
+  _debugPort = &debugPort;
+  _debugEnabled = true;
+#else
+  (void)debugPort; // Debug is compiled out
+#endif
 }
 
 /**************************************************************************/
 /*!
-    @brief  Get the VEML7700's ALS high threshold window setting (ALS_WH)
-    @param  threshold
-            <br>Will be set to the threshold setting on return
-    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+    @brief  Disable debug messages
+            <br>Does nothing if VEML7700_DISABLE_DEBUG is defined
 */
 /**************************************************************************/
-VEML7700_error_t VEML7700::getHighThreshold(uint16_t *threshold)
+void VEML7700::disableDebugging()
 {
-  return (readI2CRegister((VEML7700_t *)threshold, VEML7700_HIGH_THRESHOLD));
+#ifndef VEML7700_DISABLE_DEBUG
+  _debugEnabled = false;
+#endif
 }
 
 /**************************************************************************/
 /*!
-    @brief  Get the VEML7700's ALS high threshold window setting (ALS_WH)
-    @return The threshold setting
+    @brief  Enable the configuration cache
+            <br>_configurationRegister becomes the trusted shadow copy of the
+            <br>VEML7700_CONFIGURATION_REGISTER. The configuration getters, and getLux,
+            <br>no longer read the register over I2C. It is re-read after begin,
+            <br>after an I2C error, or when syncConfiguration is called.
 */
 /**************************************************************************/
-uint16_t VEML7700::getHighThreshold()
+void VEML7700::enableConfigurationCache()
 {
-  uint16_t threshold;
-  getHighThreshold(&threshold);
-  return (threshold);
+  _cacheConfiguration = true;
 }
 
 /**************************************************************************/
 /*!
-    @brief  Set the VEML7700's ALS low threshold window setting (ALS_WL)
-    @param  threshold
-            <br>The threshold setting: 0x0000 to 0xFFFF
-    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+    @brief  Disable the configuration cache. The configuration register is read on every access.
 */
 /**************************************************************************/
-VEML7700_error_t VEML7700::setLowThreshold(uint16_t threshold)
+void VEML7700::disableConfigurationCache()
 {
-  return (writeI2CRegister((VEML7700_t)threshold, VEML7700_LOW_THRESHOLD));
+  _cacheConfiguration = false;
 }
 
 /**************************************************************************/
 /*!
-    @brief  Get the VEML7700's ALS low threshold window setting (ALS_WL)
-    @param  threshold
-            <br>Will be set to the threshold setting on return
+    @brief  Re-read the VEML7700_CONFIGURATION_REGISTER and VEML7700_POWER_SAVING registers
+            <br>into the shadow copies
     @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
 */
 /**************************************************************************/
-VEML7700_error_t VEML7700::getLowThreshold(uint16_t *threshold)
+VEML7700_error_t VEML7700::syncConfiguration()
 {
-  return (readI2CRegister((VEML7700_t *)threshold, VEML7700_LOW_THRESHOLD));
+  VEML7700_error_t err;
+
+  _configurationValid = false;
+  _powerSaveValid = false;
+
+  err = readConfigurationRegister();
+  if (err != VEML7700_ERROR_SUCCESS)
+    return err;
+
+  return readPowerSaveRegister();
 }
 
 /**************************************************************************/
 /*!
-    @brief  Get the VEML7700's ALS low threshold window setting (ALS_WL)
-    @return The threshold setting
+    @brief  Check that the VEML7700 is awake and communicating.
+    @return True if communication with the VEML7700 was successful, otherwise false.
 */
 /**************************************************************************/
-uint16_t VEML7700::getLowThreshold()
+boolean VEML7700::isConnected()
 {
-  uint16_t threshold;
-  getLowThreshold(&threshold);
-  return (threshold);
+  if (_connected() != VEML7700_ERROR_SUCCESS)
+  {
+    return false;
+  }
+  return true;
 }
 
-/**************************************************************************/
-/*!
-    @brief  Get the VEML7700's ambient light sensor data (ALS)
-    @param  ambient
-            <br>Will be set to the ambient level on return
-    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
-*/
-/**************************************************************************/
-VEML7700_error_t VEML7700::getAmbientLight(uint16_t *ambient)
+VEML7700_error_t VEML7700::_connected()
 {
-  return (readI2CRegister((VEML7700_t *)ambient, VEML7700_ALS_OUTPUT));
-}
+  VEML7700_error_t err;
 
-/**************************************************************************/
+  err = readI2CRegister((VEML7700_t *)&_configurationRegister, VEML7700_CONFIGURATION_REGISTER);
+
+  _configurationValid = (err == VEML7700_ERROR_SUCCESS);
+  updateResolution();
+
+  if (err != VEML7700_ERROR_SUCCESS)
+  {
+#ifndef VEML7700_DISABLE_DEBUG
+    if (_debugEnabled)
+    {
+  		_debugPort->print(F("VEML7700::_connected: error: "));
+      _debugPort->println(err);
+    }
+#endif
+    return err;
+  }
+
+#ifndef VEML7700_DISABLE_DEBUG
+  if (_debugEnabled) _debugPort->println(F("VEML7700::_connected: success!"));
+#endif
+
+  return VEML7700_ERROR_SUCCESS;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set all of the VEML7700's configuration settings with a single write
+            <br>The register is not read first. The reserved bits are cleared.
+            <br>This is the cheapest way to change more than one setting at a time.
+    @param  config
+            <br>The complete configuration: shut down, interrupt enable,
+            <br>persistence protect, integration time and sensitivity mode
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::applyConfiguration(const VEML7700_config_t &config)
+{
+  _configurationRegister.all = 0x0000; // Clear the reserved bits
+  _configurationRegister.CONFIG_REG_SD = (VEML7700_t)config.shutdown;
+  _configurationRegister.CONFIG_REG_INT_EN = (VEML7700_t)config.interruptEnable;
+  _configurationRegister.CONFIG_REG_PERS = (VEML7700_t)config.persistenceProtect;
+  _configurationRegister.CONFIG_REG_IT = (VEML7700_t)integrationTimeConfig(config.integrationTime);
+  _configurationRegister.CONFIG_REG_SM = (VEML7700_t)config.sensitivityMode;
+
+  return writeConfigurationRegister();
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get all of the VEML7700's configuration settings
+            <br>Only one read is needed. No read is needed if the configuration cache is enabled.
+    @param  config
+            <br>Will be set to the complete configuration on return
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::getConfiguration(VEML7700_config_t *config)
+{
+  VEML7700_error_t err;
+
+  err = readConfigurationRegister();
+
+  if (err == VEML7700_ERROR_SUCCESS)
+  {
+    config->shutdown = (VEML7700_shutdown_t)_configurationRegister.CONFIG_REG_SD;
+    config->interruptEnable = (VEML7700_interrupt_enable_t)_configurationRegister.CONFIG_REG_INT_EN;
+    config->persistenceProtect = (VEML7700_persistence_protect_t)_configurationRegister.CONFIG_REG_PERS;
+    config->integrationTime = integrationTimeFromConfig((VEML7700_config_integration_time_t)_configurationRegister.CONFIG_REG_IT);
+    config->sensitivityMode = (VEML7700_sensitivity_mode_t)_configurationRegister.CONFIG_REG_SM;
+  }
+  else
+  {
+    config->shutdown = VEML7700_SHUTDOWN_INVALID;
+    config->interruptEnable = VEML7700_INT_INVALID;
+    config->persistenceProtect = VEML7700_PERSISTENCE_INVALID;
+    config->integrationTime = VEML7700_INTEGRATION_INVALID;
+    config->sensitivityMode = VEML7700_SENSITIVITY_INVALID;
+  }
+
+  return (err);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set the VEML7700's shut down setting (ALS_SD)
+    @param  sd
+            <br>The shut down setting. Possible values are:
+            <br>VEML7700_POWER_ON
+            <br>VEML7700_SHUT_DOWN
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::setShutdown(VEML7700_shutdown_t sd)
+{
+  VEML7700_error_t err;
+
+  err = readConfigurationRegister();
+  if (err != VEML7700_ERROR_SUCCESS)
+  {
+    return err;
+  }
+
+  _configurationRegister.CONFIG_REG_SD = (VEML7700_t)sd;
+
+  return writeConfigurationRegister();
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the VEML7700's shut down setting (ALS_SD)
+    @return VEML7700_POWER_ON or VEML7700_SHUT_DOWN if successful, VEML7700_SHUTDOWN_INVALID otherwise
+*/
+/**************************************************************************/
+VEML7700_shutdown_t VEML7700::getShutdown()
+{
+  VEML7700_error_t err;
+
+  err = readConfigurationRegister();
+  if (err != VEML7700_ERROR_SUCCESS)
+  {
+    return VEML7700_SHUTDOWN_INVALID;
+  }
+
+  return ((VEML7700_shutdown_t)_configurationRegister.CONFIG_REG_SD);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set the VEML7700's interrupt enable setting (ALS_INT_EN)
+    @param  ie
+            <br>The interrupt enable setting. Possible values are:
+            <br>VEML7700_INT_DISABLE
+            <br>VEML7700_INT_ENABLE
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::setInterruptEnable(VEML7700_interrupt_enable_t ie)
+{
+  VEML7700_error_t err;
+
+  err = readConfigurationRegister();
+  if (err != VEML7700_ERROR_SUCCESS)
+  {
+    return err;
+  }
+
+  _configurationRegister.CONFIG_REG_INT_EN = (VEML7700_t)ie;
+
+  return writeConfigurationRegister();
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the VEML7700's interrupt enable setting (ALS_INT_EN)
+    @param  ie
+            <br>Will be set to the interrupt enable setting on return
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::getInterruptEnable(VEML7700_interrupt_enable_t *ie)
+{
+  VEML7700_error_t err;
+
+  err = readConfigurationRegister();
+  
+  if (err == VEML7700_ERROR_SUCCESS)
+  {
+    *ie = (VEML7700_interrupt_enable_t)_configurationRegister.CONFIG_REG_INT_EN;
+  }
+  else
+  {
+    *ie = VEML7700_INT_INVALID;
+  }
+
+  return (err);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the VEML7700's interrupt enable setting (ALS_INT_EN)
+    @return  VEML7700_INT_DISABLE or VEML7700_INT_ENABLE if successful, VEML7700_INT_INVALID otherwise
+*/
+/**************************************************************************/
+VEML7700_interrupt_enable_t VEML7700::getInterruptEnable()
+{
+  VEML7700_error_t err;
+
+  err = readConfigurationRegister();
+  if (err != VEML7700_ERROR_SUCCESS)
+  {
+    return VEML7700_INT_INVALID;
+  }
+
+  return ((VEML7700_interrupt_enable_t)_configurationRegister.CONFIG_REG_INT_EN);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set the VEML7700's persistence protect number setting (ALS_PERS)
+    @param  pp
+            <br>The persistence protect setting. Possible values are:
+            <br>VEML7700_PERSISTENCE_1
+            <br>VEML7700_PERSISTENCE_2
+            <br>VEML7700_PERSISTENCE_4
+            <br>VEML7700_PERSISTENCE_8
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::setPersistenceProtect(VEML7700_persistence_protect_t pp)
+{
+  VEML7700_error_t err;
+
+  err = readConfigurationRegister();
+  if (err != VEML7700_ERROR_SUCCESS)
+  {
+    return err;
+  }
+
+  _configurationRegister.CONFIG_REG_PERS = (VEML7700_t)pp;
+
+  return writeConfigurationRegister();
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the VEML7700's persistence protect number setting (ALS_PERS)
+    @param  pp
+            <br>Will be set to the persistence protect number on return
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::getPersistenceProtect(VEML7700_persistence_protect_t *pp)
+{
+  VEML7700_error_t err;
+
+  err = readConfigurationRegister();
+  
+  if (err == VEML7700_ERROR_SUCCESS)
+  {
+    *pp = (VEML7700_persistence_protect_t)_configurationRegister.CONFIG_REG_PERS;
+  }
+  else
+  {
+    *pp = VEML7700_PERSISTENCE_INVALID;
+  }
+
+  return (err);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the VEML7700's persistence protect number setting (ALS_PERS)
+    @return If successful:
+            <br>VEML7700_PERSISTENCE_1
+            <br>VEML7700_PERSISTENCE_2
+            <br>VEML7700_PERSISTENCE_4
+            <br>VEML7700_PERSISTENCE_8
+            <br>Otherwise:
+            <br>VEML7700_PERSISTENCE_INVALID
+*/
+/**************************************************************************/
+VEML7700_persistence_protect_t VEML7700::getPersistenceProtect()
+{
+  VEML7700_error_t err;
+
+  err = readConfigurationRegister();
+  if (err != VEML7700_ERROR_SUCCESS)
+  {
+    return VEML7700_PERSISTENCE_INVALID;
+  }
+
+  return ((VEML7700_persistence_protect_t)_configurationRegister.CONFIG_REG_PERS);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the VEML7700's persistence protect number setting (ALS_PERS) as printable text
+*/
+/**************************************************************************/
+const char * VEML7700::getPersistenceProtectStr()
+{
+  VEML7700_persistence_protect_t pp;
+
+  getPersistenceProtect(&pp);
+
+  return (VEML7700_ramString(VEML7700_PERSISTENCE_PROTECT_SETTINGS, pp));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the VEML7700's persistence protect number setting (ALS_PERS) as printable text, from flash
+            <br>Use this to print without copying the text into RAM (e.g. Serial.print(sensor.getPersistenceProtectFlashStr()))
+*/
+/**************************************************************************/
+const __FlashStringHelper * VEML7700::getPersistenceProtectFlashStr()
+{
+  VEML7700_persistence_protect_t pp;
+
+  getPersistenceProtect(&pp);
+
+  return (VEML7700_flashString(VEML7700_PERSISTENCE_PROTECT_SETTINGS, pp));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set the VEML7700's integration time setting (ALS_IT)
+            <br>Note: these are defined here in simple sequential order
+            <br>The actual register settings are defined in VEML7700_config_integration_time_t
+    @param  it
+            <br>The integration time setting. Possible values are:
+            <br>VEML7700_INTEGRATION_25ms
+            <br>VEML7700_INTEGRATION_50ms
+            <br>VEML7700_INTEGRATION_100ms
+            <br>VEML7700_INTEGRATION_200ms
+            <br>VEML7700_INTEGRATION_400ms
+            <br>VEML7700_INTEGRATION_800ms
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::setIntegrationTime(VEML7700_integration_time_t it)
+{
+  VEML7700_error_t err;
+
+  err = readConfigurationRegister();
+  if (err != VEML7700_ERROR_SUCCESS)
+  {
+    return err;
+  }
+
+  _configurationRegister.CONFIG_REG_IT = (VEML7700_t)integrationTimeConfig(it);
+
+  return writeConfigurationRegister();
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the VEML7700's integration time setting (ALS_IT)
+    @param  it
+            <br>Will be set to the intergration time setting on return
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::getIntegrationTime(VEML7700_integration_time_t *it)
+{
+  VEML7700_error_t err;
+
+  err = readConfigurationRegister();
+
+  if (err == VEML7700_ERROR_SUCCESS)
+  {
+    *it = (VEML7700_integration_time_t)integrationTimeFromConfig((VEML7700_config_integration_time_t)_configurationRegister.CONFIG_REG_IT);
+  }
+  else
+  {
+    *it = VEML7700_INTEGRATION_INVALID;
+  }
+
+  return (err);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the VEML7700's integration time setting (ALS_IT)
+    @return If successful:
+            <br>VEML7700_INTEGRATION_25ms
+            <br>VEML7700_INTEGRATION_50ms
+            <br>VEML7700_INTEGRATION_100ms
+            <br>VEML7700_INTEGRATION_200ms
+            <br>VEML7700_INTEGRATION_400ms
+            <br>VEML7700_INTEGRATION_800ms
+            <br>Otherwise:
+            <br>VEML7700_INTEGRATION_INVALID
+*/
+/**************************************************************************/
+VEML7700_integration_time_t VEML7700::getIntegrationTime()
+{
+  VEML7700_error_t err;
+
+  err = readConfigurationRegister();
+  if (err != VEML7700_ERROR_SUCCESS)
+  {
+    return VEML7700_INTEGRATION_INVALID;
+  }
+
+  return ((VEML7700_integration_time_t)integrationTimeFromConfig((VEML7700_config_integration_time_t)_configurationRegister.CONFIG_REG_IT));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the VEML7700's integration time setting (ALS_IT) as printable text
+*/
+/**************************************************************************/
+const char * VEML7700::getIntegrationTimeStr()
+{
+  VEML7700_integration_time_t it;
+
+  getIntegrationTime(&it);
+
+  return (VEML7700_ramString(VEML7700_INTEGRATION_TIMES, it));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the VEML7700's integration time setting (ALS_IT) as printable text, from flash
+            <br>Use this to print without copying the text into RAM (e.g. Serial.print(sensor.getIntegrationTimeFlashStr()))
+*/
+/**************************************************************************/
+const __FlashStringHelper * VEML7700::getIntegrationTimeFlashStr()
+{
+  VEML7700_integration_time_t it;
+
+  getIntegrationTime(&it);
+
+  return (VEML7700_flashString(VEML7700_INTEGRATION_TIMES, it));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set the VEML7700's sensitivity mode selection (ALS_SM)
+    @param  it
+            <br>The sensitivity mode selection. Possible values are:
+            <br>VEML7700_SENSITIVITY_x1
+            <br>VEML7700_SENSITIVITY_x2
+            <br>VEML7700_SENSITIVITY_x1_8
+            <br>VEML7700_SENSITIVITY_x1_4
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::setSensitivityMode(VEML7700_sensitivity_mode_t sm)
+{
+  VEML7700_error_t err;
+
+  err = readConfigurationRegister();
+  if (err != VEML7700_ERROR_SUCCESS)
+  {
+    return err;
+  }
+
+  _configurationRegister.CONFIG_REG_SM = (VEML7700_t)sm;
+
+  return writeConfigurationRegister();
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the VEML7700's sensitivity mode selection (ALS_SM)
+    @param  sm
+            <br>Will be set to the sensitivity mode selection on return
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::getSensitivityMode(VEML7700_sensitivity_mode_t *sm)
+{
+  VEML7700_error_t err;
+
+  err = readConfigurationRegister();
+  
+  if (err == VEML7700_ERROR_SUCCESS)
+  {
+    *sm = (VEML7700_sensitivity_mode_t)_configurationRegister.CONFIG_REG_SM;
+  }
+  else
+  {
+    *sm = VEML7700_SENSITIVITY_INVALID;
+  }
+
+  return (err);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the VEML7700's sensitivity mode selection (ALS_SM)
+    @return If successful:
+            <br>VEML7700_SENSITIVITY_x1
+            <br>VEML7700_SENSITIVITY_x2
+            <br>VEML7700_SENSITIVITY_x1_8
+            <br>VEML7700_SENSITIVITY_x1_4
+            <br>Otherwise:
+            <br>VEML7700_SENSITIVITY_INVALID
+*/
+/**************************************************************************/
+VEML7700_sensitivity_mode_t VEML7700::getSensitivityMode()
+{
+  VEML7700_error_t err;
+
+  err = readConfigurationRegister();
+  if (err != VEML7700_ERROR_SUCCESS)
+  {
+    return VEML7700_SENSITIVITY_INVALID;
+  }
+
+  return ((VEML7700_sensitivity_mode_t)_configurationRegister.CONFIG_REG_SM);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the VEML7700's sensitivity mode selection (ALS_SM) as printable text
+*/
+/**************************************************************************/
+const char * VEML7700::getSensitivityModeStr()
+{
+  VEML7700_sensitivity_mode_t sm;
+
+  getSensitivityMode(&sm);
+
+  return (VEML7700_ramString(VEML7700_GAIN_SETTINGS, sm));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the VEML7700's sensitivity mode selection (ALS_SM) as printable text, from flash
+            <br>Use this to print without copying the text into RAM (e.g. Serial.print(sensor.getSensitivityModeFlashStr()))
+*/
+/**************************************************************************/
+const __FlashStringHelper * VEML7700::getSensitivityModeFlashStr()
+{
+  VEML7700_sensitivity_mode_t sm;
+
+  getSensitivityMode(&sm);
+
+  return (VEML7700_flashString(VEML7700_GAIN_SETTINGS, sm));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set the VEML7700's power saving mode enable setting (PSM_EN)
+    @param  pe
+            <br>The power saving mode enable setting. Possible values are:
+            <br>VEML7700_POWER_SAVE_DISABLE
+            <br>VEML7700_POWER_SAVE_ENABLE
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::setPowerSaveEnable(VEML7700_power_save_enable_t pe)
+{
+  VEML7700_error_t err;
+
+  err = readPowerSaveRegister();
+  if (err != VEML7700_ERROR_SUCCESS)
+  {
+    return err;
+  }
+
+  _powerSaveRegister.POWER_SAVE_REG_PSM_EN = (VEML7700_t)pe;
+
+  return writePowerSaveRegister();
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the VEML7700's power saving mode enable setting (PSM_EN)
+    @param  pe
+            <br>Will be set to the power saving mode enable setting on return
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::getPowerSaveEnable(VEML7700_power_save_enable_t *pe)
+{
+  VEML7700_error_t err;
+
+  err = readPowerSaveRegister();
+
+  if (err == VEML7700_ERROR_SUCCESS)
+  {
+    *pe = (VEML7700_power_save_enable_t)_powerSaveRegister.POWER_SAVE_REG_PSM_EN;
+  }
+  else
+  {
+    *pe = VEML7700_POWER_SAVE_INVALID;
+  }
+
+  return (err);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the VEML7700's power saving mode enable setting (PSM_EN)
+    @return VEML7700_POWER_SAVE_DISABLE or VEML7700_POWER_SAVE_ENABLE if successful,
+            <br>VEML7700_POWER_SAVE_INVALID otherwise
+*/
+/**************************************************************************/
+VEML7700_power_save_enable_t VEML7700::getPowerSaveEnable()
+{
+  VEML7700_error_t err;
+
+  err = readPowerSaveRegister();
+  if (err != VEML7700_ERROR_SUCCESS)
+  {
+    return VEML7700_POWER_SAVE_INVALID;
+  }
+
+  return ((VEML7700_power_save_enable_t)_powerSaveRegister.POWER_SAVE_REG_PSM_EN);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set the VEML7700's power saving mode (PSM)
+    @param  psm
+            <br>The power saving mode. Possible values are:
+            <br>VEML7700_POWER_SAVE_MODE_1 (500ms wait between conversions)
+            <br>VEML7700_POWER_SAVE_MODE_2 (1000ms)
+            <br>VEML7700_POWER_SAVE_MODE_3 (2000ms)
+            <br>VEML7700_POWER_SAVE_MODE_4 (4000ms)
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::setPowerSaveMode(VEML7700_power_save_mode_t psm)
+{
+  VEML7700_error_t err;
+
+  err = readPowerSaveRegister();
+  if (err != VEML7700_ERROR_SUCCESS)
+  {
+    return err;
+  }
+
+  _powerSaveRegister.POWER_SAVE_REG_PSM = (VEML7700_t)psm;
+
+  return writePowerSaveRegister();
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the VEML7700's power saving mode (PSM)
+    @param  psm
+            <br>Will be set to the power saving mode on return
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::getPowerSaveMode(VEML7700_power_save_mode_t *psm)
+{
+  VEML7700_error_t err;
+
+  err = readPowerSaveRegister();
+
+  if (err == VEML7700_ERROR_SUCCESS)
+  {
+    *psm = (VEML7700_power_save_mode_t)_powerSaveRegister.POWER_SAVE_REG_PSM;
+  }
+  else
+  {
+    *psm = VEML7700_POWER_SAVE_MODE_INVALID;
+  }
+
+  return (err);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the VEML7700's power saving mode (PSM)
+    @return If successful:
+            <br>VEML7700_POWER_SAVE_MODE_1
+            <br>VEML7700_POWER_SAVE_MODE_2
+            <br>VEML7700_POWER_SAVE_MODE_3
+            <br>VEML7700_POWER_SAVE_MODE_4
+            <br>Otherwise:
+            <br>VEML7700_POWER_SAVE_MODE_INVALID
+*/
+/**************************************************************************/
+VEML7700_power_save_mode_t VEML7700::getPowerSaveMode()
+{
+  VEML7700_error_t err;
+
+  err = readPowerSaveRegister();
+  if (err != VEML7700_ERROR_SUCCESS)
+  {
+    return VEML7700_POWER_SAVE_MODE_INVALID;
+  }
+
+  return ((VEML7700_power_save_mode_t)_powerSaveRegister.POWER_SAVE_REG_PSM);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the VEML7700's power saving mode (PSM) as printable text
+*/
+/**************************************************************************/
+const char * VEML7700::getPowerSaveModeStr()
+{
+  VEML7700_power_save_mode_t psm;
+
+  getPowerSaveMode(&psm);
+
+  return (VEML7700_ramString(VEML7700_POWER_SAVE_MODES, psm));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the VEML7700's power saving mode (PSM) as printable text, from flash
+            <br>Use this to print without copying the text into RAM (e.g. Serial.print(sensor.getPowerSaveModeFlashStr()))
+*/
+/**************************************************************************/
+const __FlashStringHelper * VEML7700::getPowerSaveModeFlashStr()
+{
+  VEML7700_power_save_mode_t psm;
+
+  getPowerSaveMode(&psm);
+
+  return (VEML7700_flashString(VEML7700_POWER_SAVE_MODES, psm));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set the VEML7700's ALS high threshold window setting (ALS_WH)
+    @param  threshold
+            <br>The threshold setting: 0x0000 to 0xFFFF
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::setHighThreshold(uint16_t threshold)
+{
+  _highThresholdLux = -1.0; // Cancel any lux target
+  return (writeI2CRegister((VEML7700_t)threshold, VEML7700_HIGH_THRESHOLD));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the VEML7700's ALS high threshold window setting (ALS_WH)
+    @param  threshold
+            <br>Will be set to the threshold setting on return
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::getHighThreshold(uint16_t *threshold)
+{
+  return (readI2CRegister((VEML7700_t *)threshold, VEML7700_HIGH_THRESHOLD));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the VEML7700's ALS high threshold window setting (ALS_WH)
+    @return The threshold setting
+*/
+/**************************************************************************/
+uint16_t VEML7700::getHighThreshold()
+{
+  uint16_t threshold = 0;
+  getHighThreshold(&threshold);
+  return (threshold);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set the VEML7700's ALS low threshold window setting (ALS_WL)
+    @param  threshold
+            <br>The threshold setting: 0x0000 to 0xFFFF
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::setLowThreshold(uint16_t threshold)
+{
+  _lowThresholdLux = -1.0; // Cancel any lux target
+  return (writeI2CRegister((VEML7700_t)threshold, VEML7700_LOW_THRESHOLD));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the VEML7700's ALS low threshold window setting (ALS_WL)
+    @param  threshold
+            <br>Will be set to the threshold setting on return
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::getLowThreshold(uint16_t *threshold)
+{
+  return (readI2CRegister((VEML7700_t *)threshold, VEML7700_LOW_THRESHOLD));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the VEML7700's ALS low threshold window setting (ALS_WL)
+    @return The threshold setting
+*/
+/**************************************************************************/
+uint16_t VEML7700::getLowThreshold()
+{
+  uint16_t threshold = 0;
+  getLowThreshold(&threshold);
+  return (threshold);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set the VEML7700's ALS high threshold in lux
+            <br>The threshold register is rewritten automatically whenever the gain or integration time changes
+            <br>(e.g. by auto-ranging), so the threshold stays at the same lux.
+            <br>The threshold is limited to the range of the current gain and integration time.
+    @param  lux
+            <br>The threshold in lux
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::setHighThresholdLux(float lux)
+{
+  _highThresholdLux = (lux < 0.0) ? 0.0 : lux;
+
+  // The conversion needs the current gain and integration time
+  VEML7700_error_t err = readConfigurationRegister();
+  if (err != VEML7700_ERROR_SUCCESS)
+    return (err);
+
+  return (writeLuxThresholds());
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the VEML7700's ALS high threshold in lux
+            <br>This is the threshold register converted using the current gain and integration time
+    @param  lux
+            <br>Will be set to the threshold in lux on return
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::getHighThresholdLux(float *lux)
+{
+  uint16_t threshold;
+  VEML7700_error_t err = readConfigurationRegister();
+
+  if (err == VEML7700_ERROR_SUCCESS)
+    err = getHighThreshold(&threshold);
+
+  if (err == VEML7700_ERROR_SUCCESS)
+    *lux = luxFromAmbient(threshold);
+
+  return (err);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the VEML7700's ALS high threshold in lux
+    @return The threshold in lux
+*/
+/**************************************************************************/
+float VEML7700::getHighThresholdLux()
+{
+  float lux = 0.0;
+  getHighThresholdLux(&lux);
+  return (lux);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set the VEML7700's ALS low threshold in lux
+            <br>The threshold register is rewritten automatically whenever the gain or integration time changes
+            <br>(e.g. by auto-ranging), so the threshold stays at the same lux.
+            <br>The threshold is limited to the range of the current gain and integration time.
+    @param  lux
+            <br>The threshold in lux
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::setLowThresholdLux(float lux)
+{
+  _lowThresholdLux = (lux < 0.0) ? 0.0 : lux;
+
+  // The conversion needs the current gain and integration time
+  VEML7700_error_t err = readConfigurationRegister();
+  if (err != VEML7700_ERROR_SUCCESS)
+    return (err);
+
+  return (writeLuxThresholds());
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the VEML7700's ALS low threshold in lux
+            <br>This is the threshold register converted using the current gain and integration time
+    @param  lux
+            <br>Will be set to the threshold in lux on return
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::getLowThresholdLux(float *lux)
+{
+  uint16_t threshold;
+  VEML7700_error_t err = readConfigurationRegister();
+
+  if (err == VEML7700_ERROR_SUCCESS)
+    err = getLowThreshold(&threshold);
+
+  if (err == VEML7700_ERROR_SUCCESS)
+    *lux = luxFromAmbient(threshold);
+
+  return (err);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the VEML7700's ALS low threshold in lux
+    @return The threshold in lux
+*/
+/**************************************************************************/
+float VEML7700::getLowThresholdLux()
+{
+  float lux = 0.0;
+  getLowThresholdLux(&lux);
+  return (lux);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the VEML7700's ambient light sensor data (ALS)
+    @param  ambient
+            <br>Will be set to the ambient level on return
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::getAmbientLight(uint16_t *ambient)
+{
+  return (readI2CRegister((VEML7700_t *)ambient, VEML7700_ALS_OUTPUT));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the VEML7700's ambient light sensor data (ALS)
+    @return The ambient light reading
+*/
+/**************************************************************************/
+uint16_t VEML7700::getAmbientLight()
+{
+  uint16_t ambient = 0;
+  getAmbientLight(&ambient);
+  return (ambient);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the VEML7700's white level data (WHITE)
+    @param  whiteLevel
+            <br>Will be set to the white level on return
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::getWhiteLevel(uint16_t *whiteLevel)
+{
+  return (readI2CRegister((VEML7700_t *)whiteLevel, VEML7700_WHITE_OUTPUT));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the VEML7700's white level data (WHITE)
+    @return The white level reading
+*/
+/**************************************************************************/
+uint16_t VEML7700::getWhiteLevel()
+{
+  uint16_t whiteLevel = 0;
+  getWhiteLevel(&whiteLevel);
+  return (whiteLevel);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the VEML7700's ambient light (ALS) and white level (WHITE) data together
+            <br>Both channels are updated at the end of each conversion.
+            <br>The VEML7700 does not auto-increment the register address, so the two
+            <br>reads are issued back-to-back. If verify is true, the ALS is read again to
+            <br>check that a conversion did not complete between the two reads. If it did,
+            <br>the pair is read again.
+    @param  ambient
+            <br>Will be set to the ambient level on return
+    @param  whiteLevel
+            <br>Will be set to the white level on return
+    @param  verify
+            <br>Optional. Default true. Set to false to skip the check. This saves one
+            <br>read, but the pair could (rarely) straddle two conversions.
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::getAmbientAndWhite(uint16_t *ambient, uint16_t *whiteLevel, bool verify)
+{
+  VEML7700_error_t err;
+  VEML7700_t levels[2];
+
+  err = readI2CRegisters(levels, VEML7700_ALS_OUTPUT, 2); // VEML7700_ALS_OUTPUT then VEML7700_WHITE_OUTPUT
+
+  if ((err == VEML7700_ERROR_SUCCESS) && verify)
+  {
+    VEML7700_t check;
+
+    err = readI2CRegisters(&check, VEML7700_ALS_OUTPUT, 1);
+
+    // Conversions are at least 25ms apart, so this cannot happen twice
+    if ((err == VEML7700_ERROR_SUCCESS) && (check != levels[0]))
+    {
+      levels[0] = check;
+      err = readI2CRegisters(&levels[1], VEML7700_WHITE_OUTPUT, 1);
+    }
+  }
+
+  if (err == VEML7700_ERROR_SUCCESS)
+  {
+    *ambient = levels[0];
+    *whiteLevel = levels[1];
+  }
+
+  return (err);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Read a burst of back-to-back conversions. This is blocking.
+            <br>Use VEML7700_INTEGRATION_25ms or VEML7700_INTEGRATION_50ms for the highest sample rate.
+            <br>The integration is restarted, then each conversion is read with one ALS transaction,
+            <br>in the middle of the following conversion. The gain and integration time come from
+            <br>the shadow copy, so enable the configuration cache to avoid re-reading them.
+            <br>The sensor's oscillator drifts relative to millis / micros, so the integration is
+            <br>restarted every VEML7700_BURST_RESYNC_SAMPLES samples. This costs one conversion
+            <br>period: use timestampsMicros to see when each sample was read.
+            <br>The sensor is left powered on, unless it was shut down before the burst.
+            <br>The samples are not checked for saturation.
+    @param  ambient
+            <br>Will be set to the count ambient levels on return
+    @param  count
+            <br>The number of samples to read
+    @param  timestampsMicros
+            <br>Optional. If not NULL, will be set to when each sample was read,
+            <br>in microseconds since the start of the burst
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::getAmbientLightBurst(uint16_t *ambient, uint16_t count, unsigned long *timestampsMicros)
+{
+  return (readBurst(ambient, count, timestampsMicros, NULL, NULL, false));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Read a burst of conversions and return the mean (oversampled) ambient level
+            <br>Averaging N conversions improves the SNR by about sqrt(N), and gives fractional counts.
+            <br>See getAmbientLightBurst for the timing.
+    @param  ambient
+            <br>Will be set to the mean ambient level on return
+    @param  count
+            <br>The number of samples to average
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+            <br>VEML7700_ERROR_SATURATED or VEML7700_ERROR_UNDERRANGE if the saturation handling
+            <br>is not VEML7700_SATURATION_IGNORE and the burst was out of range.
+            <br>ambient is still set. VEML7700_SATURATION_RETRY is treated as VEML7700_SATURATION_REPORT.
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::getAmbientLightBurstMean(float *ambient, uint16_t count)
+{
+  VEML7700_error_t err;
+  uint32_t sum;
+  uint16_t maximum;
+
+  if (count == 0)
+    return (VEML7700_ERROR_UNDEFINED);
+
+  err = readBurst(NULL, count, NULL, &sum, &maximum, false);
+
+  if (err != VEML7700_ERROR_SUCCESS)
+    return (err);
+
+  *ambient = (float)sum / (float)count;
+
+  // Any saturated sample spoils the mean. Otherwise, check the (rounded) mean
+  _sampleQuality = sampleQuality((maximum == 0xFFFF) ? maximum : (uint16_t)((sum + (count / 2)) / count));
+
+  if ((_sampleQuality == VEML7700_SAMPLE_VALID) || (_saturationHandling == VEML7700_SATURATION_IGNORE))
+    return (VEML7700_ERROR_SUCCESS);
+  if (_sampleQuality == VEML7700_SAMPLE_SATURATED)
+    return (VEML7700_ERROR_SATURATED);
+  if (_sampleQuality == VEML7700_SAMPLE_UNDERRANGE)
+    return (VEML7700_ERROR_UNDERRANGE);
+  return (VEML7700_ERROR_UNDEFINED);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Read a burst of conversions and return the mean (oversampled) lux
+            <br>See getAmbientLightBurst and getAmbientLightBurstMean
+    @param  lux
+            <br>Will be set to the mean lux on return
+    @param  count
+            <br>The number of samples to average
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::getLuxBurst(float *lux, uint16_t count)
+{
+  float ambient = 0.0;
+  VEML7700_error_t err = getAmbientLightBurstMean(&ambient, count);
+
+  if (luxIsValid(err))
+    *lux = luxFromCounts(ambient);
+
+  return (err);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Measure the flicker (e.g. from mains or a failing LED driver). This is blocking.
+            <br>Reads a burst of count conversions into buffer, then analyses it with flicker.
+            <br>For the analysis, the samples must be evenly spaced on a known clock. So,
+            <br>unlike getAmbientLightBurst, the integration is restarted for every sample,
+            <br>on a micros() schedule. This costs two transactions and a little over
+            <br>one integration time per sample.
+            <br>Use VEML7700_INTEGRATION_25ms: longer integrations average the flicker away.
+            <br>See VEML7700Flicker for which frequencies can be seen.
+    @param  flicker
+            <br>Will hold the analysis on return
+    @param  buffer
+            <br>Storage for count samples
+    @param  count
+            <br>The number of samples. More samples give a finer frequency resolution, and less noise
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+            <br>VEML7700_ERROR_UNDERRANGE if it was too dark to analyse
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::measureFlicker(VEML7700Flicker *flicker, uint16_t *buffer, uint16_t count)
+{
+  VEML7700_error_t err;
+
+  if (flicker == NULL)
+    return (VEML7700_ERROR_UNDEFINED);
+
+  err = readBurst(buffer, count, NULL, NULL, NULL, true);
+
+  if (err != VEML7700_ERROR_SUCCESS)
+    return (err);
+
+  // readBurst has checked the integration time
+  VEML7700_integration_time_t it = integrationTimeFromConfig((VEML7700_config_integration_time_t)_configurationRegister.CONFIG_REG_IT);
+
+  return (flicker->analyze(buffer, count, burstPeriodMicros(true), (unsigned long)pgm_read_word(&VEML7700_INTEGRATION_TIMES_ms[it]) * 1000));
+}
+
+unsigned long VEML7700::burstPeriodMicros(bool synchronous)
+{
+  VEML7700_integration_time_t it = integrationTimeFromConfig((VEML7700_config_integration_time_t)_configurationRegister.CONFIG_REG_IT);
+
+  if (it >= VEML7700_INTEGRATION_INVALID)
+    return (0);
+
+  // The nominal refresh time. Not measurementPeriodMillis: the margin would make a free-running burst fall behind
+  unsigned long period = (unsigned long)pgm_read_word(&VEML7700_INTEGRATION_TIMES_ms[it]) * 1000;
+  if (_powerSaveRegister.POWER_SAVE_REG_PSM_EN == VEML7700_POWER_SAVE_ENABLE)
+    period += (unsigned long)pgm_read_word(&VEML7700_POWER_SAVE_WAIT_ms[_powerSaveRegister.POWER_SAVE_REG_PSM]) * 1000;
+
+  // A synchronous burst restarts each conversion: allow for a slow oscillator and the transactions
+  if (synchronous)
+    period += ((period * VEML7700_SETTLING_MARGIN_PERCENT) / 100) + VEML7700_SYNCHRONOUS_BURST_MARGIN_us;
+
+  return (period);
+}
+
+VEML7700_error_t VEML7700::readBurst(uint16_t *ambient, uint16_t count, unsigned long *timestampsMicros, uint32_t *sum, uint16_t *maximum, bool synchronous)
+{
+  VEML7700_error_t err;
+
+  if (sum != NULL)
+    *sum = 0;
+  if (maximum != NULL)
+    *maximum = 0;
+
+  err = readConfigurationRegister(); // Gain and integration time. Does nothing if the shadow is valid.
+  if (err == VEML7700_ERROR_SUCCESS)
+    err = readPowerSaveRegister(); // The refresh time
+  if (err != VEML7700_ERROR_SUCCESS)
+    return (err);
+
+  VEML7700_integration_time_t it = integrationTimeFromConfig((VEML7700_config_integration_time_t)_configurationRegister.CONFIG_REG_IT);
+  if (((VEML7700_sensitivity_mode_t)_configurationRegister.CONFIG_REG_SM >= VEML7700_SENSITIVITY_INVALID)
+      || (it >= VEML7700_INTEGRATION_INVALID))
+    return (VEML7700_ERROR_UNDEFINED);
+
+  unsigned long period = burstPeriodMicros(synchronous);
+
+  bool shutDown = (_configurationRegister.CONFIG_REG_SD == VEML7700_SHUT_DOWN);
+  unsigned long start = 0;
+  unsigned long deadline = 0;
+
+  for (uint16_t i = 0; (i < count) && (err == VEML7700_ERROR_SUCCESS); i++)
+  {
+    if ((i == 0) || (!synchronous && ((i % VEML7700_BURST_RESYNC_SAMPLES) == 0)))
+    {
+      /** (Re)start the integration. Conversion n then completes at n periods (+/- the
+          oscillator tolerance) after the write. Reading at n + 1/2 periods gives a whole
+          half period of tolerance before a conversion is read twice or missed.
+          A synchronous burst reads the first conversion once it is certainly complete. */
+      _configurationRegister.CONFIG_REG_SD = VEML7700_POWER_ON;
+      err = writeConfigurationRegister();
+      if (err != VEML7700_ERROR_SUCCESS)
+        break;
+
+      deadline = micros();
+      if (i == 0)
+      {
+        start = deadline;
+        if (shutDown)
+          deadline += (unsigned long)VEML7700_POWER_ON_DELAY_ms * 1000;
+      }
+      deadline += synchronous ? period : period + (period / 2);
+    }
+
+    // Sleep for most of the wait, then spin on micros for the last millisecond
+    long remaining = (long)(deadline - micros());
+    if (remaining > 2000)
+      delay((unsigned long)(remaining - 1000) / 1000);
+    while ((long)(micros() - deadline) < 0)
+      ;
+
+    if (timestampsMicros != NULL)
+      timestampsMicros[i] = micros() - start;
+
+    VEML7700_t value;
+    err = readI2CRegister(&value, VEML7700_ALS_OUTPUT);
+
+    if (err == VEML7700_ERROR_SUCCESS)
+    {
+      if (ambient != NULL)
+        ambient[i] = value;
+      if (sum != NULL)
+        *sum += value;
+      if ((maximum != NULL) && (value > *maximum))
+        *maximum = value;
+    }
+
+    // Restart the next conversion straight after the read, so each one starts the same time after its deadline
+    if (synchronous && (err == VEML7700_ERROR_SUCCESS) && ((i + 1) < count))
+      err = writeConfigurationRegister();
+
+    deadline += period; // Absolute deadlines, so the read times do not drift
+  }
+
+  if (shutDown)
+  {
+    VEML7700_error_t sdErr;
+    _configurationRegister.CONFIG_REG_SD = VEML7700_SHUT_DOWN;
+    sdErr = writeConfigurationRegister();
+    if (err == VEML7700_ERROR_SUCCESS)
+      err = sdErr;
+  }
+
+#ifndef VEML7700_DISABLE_DEBUG
+  if (_debugEnabled && (err != VEML7700_ERROR_SUCCESS))
+  {
+    _debugPort->print(F("VEML7700::readBurst: failed. err: "));
+    _debugPort->println(err);
+  }
+#endif
+
+  return (err);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Read the sensor data and calculate the lux
+    @param  lux
+            <br>Will be set to the lux on return
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::getLux(float *lux)
+{
+  uint16_t ambient;
+  return (readLux(lux, &ambient));
+}
+
+VEML7700_error_t VEML7700::readLux(float *lux, uint16_t *ambient)
+{
+  /** First, we need to extract the correct resolution from the VEML7700_LUX_RESOLUTION
+      gain and integration time look up table. Let's begin by reading the gain
+      (sensitivity) and integration time.
+      Note: if the configuration cache is enabled, these come from _configurationRegister
+            and only the ALS_OUTPUT is read over I2C. */
+
+  VEML7700_error_t err;
+  VEML7700_sensitivity_mode_t sm;
+
+  err = getSensitivityMode(&sm);
+
+  if (err != VEML7700_ERROR_SUCCESS)
+    return (err);
+
+#ifndef VEML7700_DISABLE_DEBUG
+  if (_debugEnabled)
+  {
+    _debugPort->print(F("VEML7700::readLux: gain / sensitivity: "));
+    _debugPort->println(VEML7700_flashString(VEML7700_GAIN_SETTINGS, sm));
+  }
+#endif
+
+  VEML7700_integration_time_t it;
+
+  err = getIntegrationTime(&it);
+
+  if (err != VEML7700_ERROR_SUCCESS)
+    return (err);
+
+#ifndef VEML7700_DISABLE_DEBUG
+  if (_debugEnabled)
+  {
+    _debugPort->print(F("VEML7700::readLux: integration time: "));
+    _debugPort->println(VEML7700_flashString(VEML7700_INTEGRATION_TIMES, it));
+  }
+#endif
+
+  /** Now we can extract the correct resolution from the look up table. */
+#ifndef VEML7700_DISABLE_DEBUG
+  if (_debugEnabled)
+  {
+    _debugPort->print(F("VEML7700::readLux: resolution: "));
+    _debugPort->println(pgm_read_float(&VEML7700_LUX_RESOLUTION[sm][it]), 4);
+  }
+#endif
+
+  /** Now we read the ambient level and multiply it by the resolution */
+  err = getAmbientLight(ambient);
+
+  if (err != VEML7700_ERROR_SUCCESS)
+    return (err);
+
+#ifndef VEML7700_DISABLE_DEBUG
+  if (_debugEnabled)
+  {
+    _debugPort->print(F("VEML7700::readLux: ambient: "));
+    _debugPort->println(*ambient);
+  }
+#endif
+
+  /** Check for saturation. This may change the range and read the ALS again */
+  err = checkSampleQuality(ambient, true);
+
+  if (!luxIsValid(err))
+    return (err);
+
+  *lux = luxFromAmbient(*ambient); // ambient * resolution, for the (possibly new) range
+
+#ifndef VEML7700_DISABLE_DEBUG
+  if (_debugEnabled)
+  {
+    _debugPort->print(F("VEML7700::readLux: lux: "));
+    _debugPort->println(*lux, 4);
+  }
+#endif
+
+  return (err);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Read the sensor data and calculate the lux
+    @return The lux
+*/
+/**************************************************************************/
+float VEML7700::getLux()
+{
+  float lux = 0.0;
+  getLux(&lux);
+  return (lux);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Read the sensor data and calculate the lux in millilux, using integer math only
+            <br>Matches getLux(float *) within rounding (+/- 0.5 millilux)
+    @param  milliLux
+            <br>Will be set to the lux * 1000 on return
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::getLuxMilli(uint32_t *milliLux)
+{
+  VEML7700_error_t err;
+  uint16_t ambient;
+
+  err = readConfigurationRegister(); // Gain and integration time. Does nothing if the shadow is valid.
+
+  if (err != VEML7700_ERROR_SUCCESS)
+    return (err);
+
+  err = getAmbientLight(&ambient);
+
+  if (err != VEML7700_ERROR_SUCCESS)
+    return (err);
+
+  err = checkSampleQuality(&ambient, true);
+
+  if (!luxIsValid(err))
+    return (err);
+
+  *milliLux = milliLuxFromAmbient(ambient);
+
+#ifndef VEML7700_DISABLE_DEBUG
+  if (_debugEnabled)
+  {
+    _debugPort->print(F("VEML7700::getLuxMilli: ambient: "));
+    _debugPort->print(ambient);
+    _debugPort->print(F(" millilux: "));
+    _debugPort->println(*milliLux);
+  }
+#endif
+
+  return (err);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Read the sensor data and calculate the lux in millilux, using integer math only
+    @return The lux * 1000
+*/
+/**************************************************************************/
+uint32_t VEML7700::getLuxMilli()
+{
+  uint32_t milliLux = 0;
+  getLuxMilli(&milliLux);
+  return (milliLux);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Read the sensor data and calculate the lux, with the non-linearity correction
+            <br>from the VEML7700 Application Note applied above 1000 lux.
+            <br>Below 1000 lux, this is the same as getLux.
+    @param  lux
+            <br>Will be set to the corrected lux on return
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::getLuxCorrected(float *lux)
+{
+  VEML7700_error_t err;
+  uint16_t ambient;
+
+  err = readLux(lux, &ambient);
+
+  // At or below the correction threshold, the lux from readLux needs no correction
+  if (luxIsValid(err) && (ambient > _correctionCounts))
+  {
+    /** The correction is for the sensor's non-linearity, so apply it to the datasheet lux.
+        Then apply the per-unit calibration. */
+    VEML7700_sensitivity_mode_t sm = (VEML7700_sensitivity_mode_t)_configurationRegister.CONFIG_REG_SM;
+    VEML7700_integration_time_t it = integrationTimeFromConfig((VEML7700_config_integration_time_t)_configurationRegister.CONFIG_REG_IT);
+    float datasheetLux = (float)ambient * pgm_read_float(&VEML7700_LUX_RESOLUTION[sm][it]);
+    *lux = applyCalibrationTable((correctLux(datasheetLux) * _calibrationGain) + _calibrationOffset);
+  }
+
+  return (err);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Read the sensor data and calculate the lux, with the non-linearity correction
+    @return The corrected lux
+*/
+/**************************************************************************/
+float VEML7700::getLuxCorrected()
+{
+  float lux = 0.0;
+  getLuxCorrected(&lux);
+  return (lux);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Read the sensor data and calculate the lux in millilux, with the non-linearity
+            <br>correction applied above 1000 lux. Uses integer (fixed-point) math only.
+    @param  milliLux
+            <br>Will be set to the corrected lux * 1000 on return.
+            <br>Limited to 0xFFFFFFFF.
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::getLuxCorrectedMilli(uint32_t *milliLux)
+{
+  VEML7700_error_t err;
+  uint16_t ambient;
+
+  err = readConfigurationRegister(); // Gain and integration time. Does nothing if the shadow is valid.
+
+  if (err != VEML7700_ERROR_SUCCESS)
+    return (err);
+
+  err = getAmbientLight(&ambient);
+
+  if (err != VEML7700_ERROR_SUCCESS)
+    return (err);
+
+  err = checkSampleQuality(&ambient, true);
+
+  if (!luxIsValid(err))
+    return (err);
+
+  // At or below the correction threshold, this is getLuxMilli
+  if (ambient <= _correctionCounts)
+  {
+    *milliLux = milliLuxFromAmbient(ambient);
+    return (err);
+  }
+
+  /** The correction is for the sensor's non-linearity, so apply it to the datasheet lux.
+      Then apply the per-unit calibration. */
+  VEML7700_sensitivity_mode_t sm = (VEML7700_sensitivity_mode_t)_configurationRegister.CONFIG_REG_SM;
+  VEML7700_integration_time_t it = integrationTimeFromConfig((VEML7700_config_integration_time_t)_configurationRegister.CONFIG_REG_IT);
+  uint32_t datasheetMilliLux = (((uint32_t)ambient * pgm_read_word(&VEML7700_LUX_RESOLUTION_x10000[sm][it])) + 5) / 10;
+  uint32_t corrected = correctMilliLux(datasheetMilliLux);
+
+  if (!_calibrated)
+    *milliLux = corrected;
+  else
+    *milliLux = applyCalibrationTableMilli((int64_t)((((uint64_t)corrected * _calibrationGainQ16) + 0x8000) >> 16) + _calibrationOffsetMilli);
+
+  return (err);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Read the sensor data and calculate the lux in millilux, with the non-linearity correction
+    @return The corrected lux * 1000
+*/
+/**************************************************************************/
+uint32_t VEML7700::getLuxCorrectedMilli()
+{
+  uint32_t milliLux = 0;
+  getLuxCorrectedMilli(&milliLux);
+  return (milliLux);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Start an asynchronous read of the ALS (Ambient Light Sensor) level
+            <br>Returns as soon as the transport has started the read.
+            <br>callback is called with the result when the read completes.
+            <br>With an interrupt or DMA driven transport, callback may be called from interrupt context.
+    @param  callback
+            <br>Called with the error code and the ALS count
+    @param  context
+            <br>Passed to callback unchanged
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if the read was started
+            <br>VEML7700_ERROR_BUSY if an asynchronous read is already in progress
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::readAmbientLightAsync(VEML7700_ambient_callback_t callback, void *context)
+{
+  return (readAsync(callback, NULL, context));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Start an asynchronous read of the lux
+            <br>Returns as soon as the transport has started the read.
+            <br>callback is called with the result when the read completes.
+            <br>With an interrupt or DMA driven transport, callback may be called from interrupt context.
+            <br>The lux is calculated using the configuration shadow copy. If the configuration
+            <br>cache is disabled (or not yet valid), the configuration is read (blocking) first.
+    @param  callback
+            <br>Called with the error code and the lux
+    @param  context
+            <br>Passed to callback unchanged
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if the read was started
+            <br>VEML7700_ERROR_BUSY if an asynchronous read is already in progress
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::readLuxAsync(VEML7700_lux_callback_t callback, void *context)
+{
+  if (_asyncBusy)
+    return (VEML7700_ERROR_BUSY);
+
+  // Make sure the shadow copy holds the gain and integration time the conversion used
+  VEML7700_error_t err = readConfigurationRegister();
+  if (err != VEML7700_ERROR_SUCCESS)
+    return (err);
+
+  return (readAsync(NULL, callback, context));
+}
+
+VEML7700_error_t VEML7700::readAsync(VEML7700_ambient_callback_t ambientCallback, VEML7700_lux_callback_t luxCallback, void *context)
+{
+  if (_transport == NULL)
+    return (VEML7700_ERROR_UNDEFINED);
+
+  if (_asyncBusy)
+    return (VEML7700_ERROR_BUSY);
+
+  _asyncAmbientCallback = ambientCallback;
+  _asyncLuxCallback = luxCallback;
+  _asyncContext = context;
+
+  // The lock is released by asyncComplete
+  if (!lockBus())
+    return (VEML7700_ERROR_BUSY);
+
+  _asyncBusy = true;
+
+#ifdef VEML7700_ENABLE_BUS_STATS
+  _asyncStartMicros = micros();
+#endif
+
+  VEML7700_error_t err = _transport->readAsync(_deviceAddress, VEML7700_ALS_OUTPUT, _asyncBuffer, VEML7700_REGISTER_LENGTH,
+                                               asyncComplete, this);
+
+  // The callback is not called if the read could not be started
+  if (err != VEML7700_ERROR_SUCCESS)
+  {
+    _asyncBusy = false;
+    unlockBus();
+#ifdef VEML7700_ENABLE_BUS_STATS
+    recordTransaction(false, VEML7700_REGISTER_LENGTH, err, _asyncStartMicros);
+#endif
+  }
+
+  return (err);
+}
+
+void VEML7700::asyncComplete(VEML7700_error_t err, void *context)
+{
+  VEML7700 *sensor = (VEML7700 *)context;
+  uint16_t ambient = 0;
+
+  sensor->unlockBus();
+
+#ifdef VEML7700_ENABLE_BUS_STATS
+  sensor->recordTransaction(false, VEML7700_REGISTER_LENGTH, err, sensor->_asyncStartMicros);
+#endif
+
+  if (err == VEML7700_ERROR_SUCCESS)
+    ambient = ((uint16_t)sensor->_asyncBuffer[0]) | (((uint16_t)sensor->_asyncBuffer[1]) << 8);
+
+  // Take a copy of the callbacks and clear _asyncBusy first, so the callback can start the next read
+  VEML7700_ambient_callback_t ambientCallback = sensor->_asyncAmbientCallback;
+  VEML7700_lux_callback_t luxCallback = sensor->_asyncLuxCallback;
+  void *userContext = sensor->_asyncContext;
+  float lux = 0.0;
+  if ((luxCallback != NULL) && (err == VEML7700_ERROR_SUCCESS))
+    lux = sensor->luxFromAmbient(ambient);
+  sensor->_asyncBusy = false;
+
+  if (ambientCallback != NULL)
+    ambientCallback(err, ambient, userContext);
+  if (luxCallback != NULL)
+    luxCallback(err, lux, userContext);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set what the lux reads do with saturated and under range samples
+            <br>A sample is saturated if the ALS count is 0xFFFF. It is under range if the count
+            <br>is below 10 and a more sensitive gain / integration time is available.
+            <br>getSampleQuality always reports the quality of the last reading.
+    @param  handling
+            <br>VEML7700_SATURATION_IGNORE: return the lux as normal (default)
+            <br>VEML7700_SATURATION_REPORT: return VEML7700_ERROR_SATURATED or VEML7700_ERROR_UNDERRANGE.
+            <br>The lux is still set.
+            <br>VEML7700_SATURATION_RETRY: jump to the predicted gain and integration time (as auto-ranging does)
+            <br>and read again. The blocking reads wait for the new conversion; poll returns
+            <br>VEML7700_ERROR_NOT_READY. The error is reported if the range limit is reached.
+            <br>Note: this changes the gain and integration time.
+*/
+/**************************************************************************/
+void VEML7700::setSaturationHandling(VEML7700_saturation_handling_t handling)
+{
+  if (handling < VEML7700_SATURATION_INVALID)
+    _saturationHandling = handling;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Add a sink: a callback fed with the readings from poll
+            <br>Each fresh conversion is read once by poll and published to every sink,
+            <br>so several consumers (e.g. dimming, telemetry and logging) share one bus read.
+            <br>Only valid readings are published (see setSaturationHandling).
+            <br>The sinks are called from poll, in the order they were added.
+            <br>Do not add or remove sinks from a sink callback.
+            <br>Adding a sink that is already present (the same callback and context) updates its filters.
+    @param  callback
+            <br>Called with the ALS count and lux
+    @param  context
+            <br>Passed to callback unchanged
+    @param  decimation
+            <br>Optional. Publish every nth reading. Default is 1 (every reading)
+    @param  changeThresholdLux
+            <br>Optional. Only publish a (decimated) reading if it differs from the last one published
+            <br>to this sink by at least this much. Default is 0.0 (publish every reading)
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+            <br>VEML7700_ERROR_UNDEFINED if callback is NULL or all VEML7700_MAX_SINKS are in use
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::addSink(VEML7700_sink_callback_t callback, void *context, uint8_t decimation, float changeThresholdLux)
+{
+  uint8_t i;
+
+  if (callback == NULL)
+    return (VEML7700_ERROR_UNDEFINED);
+
+  for (i = 0; i < _sinkCount; i++)
+    if ((_sinks[i].callback == callback) && (_sinks[i].context == context))
+      break;
+
+  if (i == VEML7700_MAX_SINKS)
+    return (VEML7700_ERROR_UNDEFINED); // Full
+
+  if (i == _sinkCount)
+    _sinkCount++;
+
+  _sinks[i].callback = callback;
+  _sinks[i].context = context;
+  _sinks[i].decimation = (decimation == 0) ? 1 : decimation;
+  _sinks[i].changeThresholdLux = (changeThresholdLux < 0.0) ? 0.0 : changeThresholdLux;
+  _sinks[i].count = 0;
+  _sinks[i].lastLux = 0.0;
+  _sinks[i].published = false;
+
+  return (VEML7700_ERROR_SUCCESS);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Remove a sink added with addSink
+    @param  callback
+            <br>The callback
+    @param  context
+            <br>The context it was added with
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+            <br>VEML7700_ERROR_UNDEFINED if the sink was not found
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::removeSink(VEML7700_sink_callback_t callback, void *context)
+{
+  for (uint8_t i = 0; i < _sinkCount; i++)
+  {
+    if ((_sinks[i].callback == callback) && (_sinks[i].context == context))
+    {
+      // Keep the table packed, and in the order the sinks were added
+      for (; (i + 1) < _sinkCount; i++)
+        _sinks[i] = _sinks[i + 1];
+      _sinkCount--;
+      return (VEML7700_ERROR_SUCCESS);
+    }
+  }
+
+  return (VEML7700_ERROR_UNDEFINED);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Start non-blocking measurements
+            <br>Powers on the ALS (if needed) and starts timing the conversions.
+            <br>Use isMeasurementReady or poll to collect each new conversion.
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::startMeasurement()
+{
+  VEML7700_error_t err;
+
+  err = readConfigurationRegister();
+  if (err != VEML7700_ERROR_SUCCESS)
+  {
+    return err;
+  }
+
+  /** Writing the configuration register restarts the integration.
+      writeConfigurationRegister will (re)start the timer. */
+  _measurementActive = true;
+  _configurationRegister.CONFIG_REG_SD = VEML7700_POWER_ON;
+
+  return writeConfigurationRegister();
+}
+
+/**************************************************************************/
+/*!
+    @brief  Check if a fresh conversion is available. Does not use I2C.
+    @return True if startMeasurement has been called and a new conversion has completed
+            <br>since the last one was read by poll
+*/
+/**************************************************************************/
+bool VEML7700::isMeasurementReady()
+{
+  return (_measurementActive && ((long)(millis() - _nextSampleMillis) >= 0));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Read the lux - but only if a fresh conversion is available
+            <br>Call startMeasurement first
+    @param  lux
+            <br>Will be set to the lux on return, if a new conversion was available
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if a new conversion was read
+            <br>VEML7700_ERROR_NOT_READY if the conversion is not complete yet
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::poll(float *lux)
+{
+  VEML7700_error_t err;
+  uint16_t ambient;
+
+  err = pollAmbientLight(&ambient);
+
+  if (luxIsValid(err))
+    *lux = luxFromAmbient(ambient);
+
+  return (err);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Read the lux in millilux - but only if a fresh conversion is available
+            <br>Uses integer math only
+            <br>Call startMeasurement first
+    @param  milliLux
+            <br>Will be set to the lux * 1000 on return, if a new conversion was available
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if a new conversion was read
+            <br>VEML7700_ERROR_NOT_READY if the conversion is not complete yet
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::poll(uint32_t *milliLux)
+{
+  VEML7700_error_t err;
+  uint16_t ambient;
+
+  err = pollAmbientLight(&ambient);
+
+  if (luxIsValid(err))
+    *milliLux = milliLuxFromAmbient(ambient);
+
+  return (err);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the time between conversions for the current integration time,
+            <br>including the settling margin and the power saving mode wait time
+    @return The measurement period in milliseconds
+*/
+/**************************************************************************/
+unsigned long VEML7700::getMeasurementPeriodMillis()
+{
+  VEML7700_integration_time_t it = VEML7700_INTEGRATION_INVALID; // measurementPeriodMillis is conservative if the read fails
+
+  getIntegrationTime(&it);
+  readPowerSaveRegister(); // Update the _powerSaveRegister shadow (if needed)
+
+  return (measurementPeriodMillis(it));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Enable automatic ranging
+            <br>poll will change the gain (sensitivity) and integration time when
+            <br>the ALS count is outside the hysteresis band. The new range is predicted
+            <br>from the count and the ratio of the resolutions, so a valid reading normally
+            <br>takes two conversions (three if the ALS was saturated).
+            <br>The ladder uses the gain first, then the integration time.
+            <br>poll returns VEML7700_ERROR_NOT_READY until a conversion inside
+            <br>the band is available (or the range limit is reached).
+*/
+/**************************************************************************/
+void VEML7700::enableAutoRange()
+{
+  _autoRange = true;
+  _autoRangeConversions = 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Disable automatic ranging
+*/
+/**************************************************************************/
+void VEML7700::disableAutoRange()
+{
+  _autoRange = false;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set the auto-range hysteresis band
+    @param  low
+            <br>The sensitivity is increased if the ALS count is below this. Default is 100.
+    @param  high
+            <br>The sensitivity is decreased if the ALS count is above this. Default is 10000.
+            <br>high should be at least 4 * low, so that a single range step cannot
+            <br>move the count from one side of the band to the other.
+*/
+/**************************************************************************/
+void VEML7700::setAutoRangeThresholds(uint16_t low, uint16_t high)
+{
+  _autoRangeLow = low;
+  _autoRangeHigh = high;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the number of conversions auto-ranging needed to reach the last valid reading
+    @return The number of conversions, including the final one. 1 means the range did not change.
+*/
+/**************************************************************************/
+uint8_t VEML7700::getAutoRangeConversions()
+{
+  return (_lastAutoRangeConversions);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the worst-case time from startMeasurement to a valid auto-ranged lux
+            <br>(assuming the light level does not change while ranging)
+            <br>The worst case is either: the ALS is saturated, so we need a conversion at the
+            <br>least sensitive cell (x1/8, 25ms) before jumping to the correct cell;
+            <br>or the correct cell is the most sensitive (x2, 800ms).
+            <br>Starting from each cell of the ladder, the worst-case times are:
+            <br>x1/8 25ms: 913ms
+            <br>x1/4 25ms: 913ms
+            <br>x1 25ms: 913ms
+            <br>x2 25ms: 913ms
+            <br>x2 50ms: 941ms
+            <br>x2 100ms: 996ms
+            <br>x2 200ms: 1106ms
+            <br>x2 400ms: 1326ms
+            <br>x2 800ms: 1356ms
+    @param  sm
+            <br>The starting sensitivity mode (gain)
+    @param  it
+            <br>The starting integration time
+    @return The worst-case time in milliseconds
+*/
+/**************************************************************************/
+unsigned long VEML7700::getAutoRangeWorstCaseMillis(VEML7700_sensitivity_mode_t sm, VEML7700_integration_time_t it)
+{
+  uint8_t cell = 0;
+  unsigned long last = VEML7700_NUM_RANGE_CELLS - 1;
+
+  if ((sm < VEML7700_SENSITIVITY_INVALID) && (it < VEML7700_INTEGRATION_INVALID))
+  {
+    while ((cell < last) && (rangeCellResolution(cell + 1) >= pgm_read_word(&VEML7700_LUX_RESOLUTION_x10000[sm][it])))
+      cell++;
+  }
+
+  // Each conversion follows a configuration write, which adds the power-on delay
+  unsigned long first = VEML7700_POWER_ON_DELAY_ms + measurementPeriodMillis(it);
+  unsigned long dark = 0;
+  unsigned long saturated = 0;
+
+  // Too dark: one jump to a more sensitive cell, at worst the last
+  if (cell < last)
+    dark = VEML7700_POWER_ON_DELAY_ms + measurementPeriodMillis((VEML7700_integration_time_t)pgm_read_byte(&VEML7700_RANGE_LADDER[last][1]));
+
+  // Saturated: one conversion at the least sensitive cell, then a jump to a cell less sensitive than this one
+  if (cell > 0)
+    saturated = VEML7700_POWER_ON_DELAY_ms + measurementPeriodMillis((VEML7700_integration_time_t)pgm_read_byte(&VEML7700_RANGE_LADDER[0][1]))
+                + VEML7700_POWER_ON_DELAY_ms + measurementPeriodMillis((VEML7700_integration_time_t)pgm_read_byte(&VEML7700_RANGE_LADDER[cell - 1][1]));
+
+  return (first + ((dark > saturated) ? dark : saturated));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Read the lux using auto-ranging. This is blocking.
+            <br>Waits until a conversion inside the hysteresis band is available.
+            <br>Use getAutoRangeConversions to see how many conversions were needed.
+    @param  lux
+            <br>Will be set to the lux on return
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::getAutoRangedLux(float *lux)
+{
+  VEML7700_error_t err = VEML7700_ERROR_SUCCESS;
+  bool autoRange = _autoRange;
+
+  if (!_measurementActive)
+    err = startMeasurement();
+
+  if (err != VEML7700_ERROR_SUCCESS)
+    return (err);
+
+  if (!autoRange)
+    enableAutoRange();
+
+  do
+  {
+    while (!isMeasurementReady())
+      delay(1);
+
+    err = poll(lux);
+  } while (err == VEML7700_ERROR_NOT_READY);
+
+  _autoRange = autoRange;
+
+  return (err);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Read the VEML7700's interrupt status register
+            <br>Note: reading the interrupt status register clears the interrupts.
+            <br>      So, we need to check both interrupt flags in a single read.
+    @param  status
+            <br>Will be set to the logical OR of ALS_IF_L and ALS_IF_H on return
+            <br>Possible values are:
+            <br>VEML7700_INT_STATUS_NONE
+            <br>VEML7700_INT_STATUS_HIGH
+            <br>VEML7700_INT_STATUS_LOW
+            <br>VEML7700_INT_STATUS_BOTH
+            <br>If an I2C error occurred, status will be:
+            <br>VEML7700_INT_STATUS_INVALID
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::getInterruptStatus(VEML7700_interrupt_status_t *status)
+{
+  VEML7700_error_t err;
+  VEML7700_INTERRUPT_STATUS_REGISTER_t isr;
+
+  err = readI2CRegister((VEML7700_t *)&isr, VEML7700_INTERRUPT_STATUS);
+
+  if (err == VEML7700_ERROR_SUCCESS)
+  {
+    *status = (VEML7700_interrupt_status_t)isr.INT_STATUS_REG_INT_FLAGS;
+  }
+  else
+  {
+    *status = VEML7700_INT_STATUS_INVALID;
+  }
+
+  return (err);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Read the VEML7700's interrupt status register
+            <br>Note: reading the interrupt status register clears the interrupts.
+            <br>      So, we need to check both interrupt flags in a single read.
+    @return If successful:
+            <br>VEML7700_INT_STATUS_NONE
+            <br>VEML7700_INT_STATUS_HIGH
+            <br>VEML7700_INT_STATUS_LOW
+            <br>VEML7700_INT_STATUS_BOTH
+            <br>Otherwise:
+            <br>VEML7700_INT_STATUS_INVALID
+*/
+/**************************************************************************/
+VEML7700_interrupt_status_t VEML7700::getInterruptStatus()
+{
+  VEML7700_error_t err;
+  VEML7700_INTERRUPT_STATUS_REGISTER_t isr;
+
+  err = readI2CRegister((VEML7700_t *)&isr, VEML7700_INTERRUPT_STATUS);
+
+  if (err != VEML7700_ERROR_SUCCESS)
+    return (VEML7700_INT_STATUS_INVALID);
+
+  return ((VEML7700_interrupt_status_t)isr.INT_STATUS_REG_INT_FLAGS);  
+}
+
+/**************************************************************************/
+/*!
+    @brief  Attach an interrupt to the GPIO connected to the sensor's INT line
+            <br>INT is active low (open drain), so the pin uses INPUT_PULLUP and a FALLING edge.
+            <br>The ISR only sets a flag. Call service regularly to handle the events.
+            <br>Remember to set the thresholds and call setInterruptEnable(VEML7700_INT_ENABLE).
+            <br>Note: the VEML7700 itself has no INT pin. This is for boards using a
+            <br>pin-compatible sensor (e.g. the VEML6030) with INT connected.
+    @param  pin
+            <br>The GPIO connected to INT. It must support interrupts
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+            <br>VEML7700_ERROR_UNDEFINED if the pin does not support interrupts,
+            <br>or VEML7700_MAX_INTERRUPT_PINS sensors are already attached
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::attachInterruptPin(uint8_t pin)
+{
+  if (digitalPinToInterrupt(pin) == NOT_AN_INTERRUPT)
+    return (VEML7700_ERROR_UNDEFINED);
+
+  detachInterruptPin(); // In case we are already attached
+
+  for (int8_t slot = 0; slot < VEML7700_MAX_INTERRUPT_PINS; slot++)
+  {
+    if (VEML7700_INTERRUPT_INSTANCES[slot] == NULL)
+    {
+      VEML7700_INTERRUPT_INSTANCES[slot] = this;
+      _interruptSlot = slot;
+      _interruptPin = pin;
+
+      pinMode(pin, INPUT_PULLUP);
+      attachInterrupt(digitalPinToInterrupt(pin), VEML7700_INTERRUPT_ISRS[slot], FALLING);
+
+      // If INT is already low, the falling edge has been missed
+      _interruptPending = (digitalRead(pin) == LOW);
+
+      return (VEML7700_ERROR_SUCCESS);
+    }
+  }
+
+  return (VEML7700_ERROR_UNDEFINED);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Detach the interrupt attached by attachInterruptPin
+*/
+/**************************************************************************/
+void VEML7700::detachInterruptPin()
+{
+  if (_interruptPin >= 0)
+    detachInterrupt(digitalPinToInterrupt((uint8_t)_interruptPin));
+
+  if (_interruptSlot >= 0)
+    VEML7700_INTERRUPT_INSTANCES[_interruptSlot] = NULL;
+
+  _interruptPin = -1;
+  _interruptSlot = -1;
+  _interruptPending = false;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set the callback called by service when the high threshold has been exceeded
+    @param  callback
+            <br>The function to call. NULL to remove the callback
+    @param  context
+            <br>Passed to callback unchanged
+*/
+/**************************************************************************/
+void VEML7700::setHighThresholdCallback(VEML7700_threshold_callback_t callback, void *context)
+{
+  _highThresholdCallback = callback;
+  _highThresholdContext = context;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set the callback called by service when the low threshold has been exceeded
+    @param  callback
+            <br>The function to call. NULL to remove the callback
+    @param  context
+            <br>Passed to callback unchanged
+*/
+/**************************************************************************/
+void VEML7700::setLowThresholdCallback(VEML7700_threshold_callback_t callback, void *context)
+{
+  _lowThresholdCallback = callback;
+  _lowThresholdContext = context;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Handle any threshold events
+            <br>Does nothing (no I2C traffic) unless the INT pin has signalled an event.
+            <br>Otherwise: reads (and clears) the interrupt status and calls the callbacks.
+            <br>Call this regularly from loop (not from an ISR).
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+            <br>If the status read fails, the event stays pending and is retried by the next service
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::service()
+{
+  if (!_interruptPending)
+    return (VEML7700_ERROR_SUCCESS);
+
+  // Clear the flag before reading the status, so an edge during the read is not lost
+  _interruptPending = false;
+
+  VEML7700_interrupt_status_t status;
+  VEML7700_error_t err = getInterruptStatus(&status);
+
+  if (err != VEML7700_ERROR_SUCCESS)
+  {
+    _interruptPending = true;
+    return (err);
+  }
+
+  if ((status & VEML7700_INT_STATUS_HIGH) && (_highThresholdCallback != NULL))
+    _highThresholdCallback(_highThresholdContext);
+
+  if ((status & VEML7700_INT_STATUS_LOW) && (_lowThresholdCallback != NULL))
+    _lowThresholdCallback(_lowThresholdContext);
+
+  // The status read has cleared the interrupt. Re-centre the window on the new reading
+  if ((_windowPercent > 0) && (status != VEML7700_INT_STATUS_NONE))
+  {
+    uint16_t ambient;
+    err = getAmbientLight(&ambient);
+
+    if (err == VEML7700_ERROR_SUCCESS)
+      err = centreWindow(ambient);
+
+    if (err != VEML7700_ERROR_SUCCESS)
+    {
+      _interruptPending = true; // Try again on the next service
+      return (err);
+    }
+
+    if (_windowCallback != NULL)
+      _windowCallback(ambient, luxFromAmbient(ambient), _windowContext);
+  }
+
+  // Reading the status releases INT. If it is still low, another event is waiting
+  if ((_interruptPin >= 0) && (digitalRead((uint8_t)_interruptPin) == LOW))
+    _interruptPending = true;
+
+  return (VEML7700_ERROR_SUCCESS);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Enable window tracking
+            <br>The threshold window is centred on the current reading, +/- percent.
+            <br>When the lux moves outside the window (for pp consecutive conversions), the sensor
+            <br>signals INT. service then reads the ALS, re-centres the window on it, and calls the
+            <br>window change callback. In stable light, there is no I2C traffic at all.
+            <br>The window is held as lux thresholds (see setHighThresholdLux), so it is rescaled
+            <br>if the gain or integration time change.
+            <br>Enables the interrupt and sets the persistence protect number.
+            <br>Use attachInterruptPin (or interruptHandler) to signal the events.
+    @param  percent
+            <br>The half-width of the window, as a percentage of the reading: 1 to 255
+    @param  pp
+            <br>The persistence protect number: the number of consecutive conversions outside
+            <br>the window needed to signal INT. Use this to ignore short flashes and shadows.
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700::enableWindowTracking(uint8_t percent, VEML7700_persistence_protect_t pp)
+{
+  VEML7700_error_t err;
+  uint16_t ambient;
+
+  if ((percent == 0) || (pp >= VEML7700_PERSISTENCE_INVALID))
+    return (VEML7700_ERROR_UNDEFINED);
+
+  err = readConfigurationRegister();
+  if (err != VEML7700_ERROR_SUCCESS)
+    return (err);
+
+  // Set the persistence and enable the interrupt in a single write
+  _configurationRegister.CONFIG_REG_PERS = (VEML7700_t)pp;
+  _configurationRegister.CONFIG_REG_INT_EN = (VEML7700_t)VEML7700_INT_ENABLE;
+  err = writeConfigurationRegister();
+
+  if (err == VEML7700_ERROR_SUCCESS)
+    err = getAmbientLight(&ambient);
+
+  if (err == VEML7700_ERROR_SUCCESS)
+  {
+    _windowPercent = percent;
+    err = centreWindow(ambient);
+  }
+
+  return (err);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Disable window tracking
+            <br>The threshold registers and the interrupt enable are left unchanged,
+            <br>but the window is no longer re-centred or rescaled
+*/
+/**************************************************************************/
+void VEML7700::disableWindowTracking()
+{
+  _windowPercent = 0;
+  _highThresholdLux = -1.0;
+  _lowThresholdLux = -1.0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set the callback called by service each time the window is re-centred
+    @param  callback
+            <br>Called with the new ALS count and lux. NULL to remove the callback
+    @param  context
+            <br>Passed to callback unchanged
+*/
+/**************************************************************************/
+void VEML7700::setWindowChangeCallback(VEML7700_change_callback_t callback, void *context)
+{
+  _windowCallback = callback;
+  _windowContext = context;
+}
+
+VEML7700_error_t VEML7700::centreWindow(uint16_t ambient)
+{
+  // luxFromAmbient needs the current gain and integration time
+  VEML7700_error_t err = readConfigurationRegister();
+  if (err != VEML7700_ERROR_SUCCESS)
+    return (err);
+
+  float lux = luxFromAmbient(ambient);
+  float halfWidth = (lux * (float)_windowPercent) / 100.0;
+
+  _highThresholdLux = lux + halfWidth;
+  _lowThresholdLux = (halfWidth >= lux) ? 0.0 : lux - halfWidth;
+
+  return (writeLuxThresholds());
+}
+
+VEML7700_error_t VEML7700::readI2CBuffer(uint8_t *dest, VEML7700_registers_t startRegister, uint16_t len)
+{
+  VEML7700_error_t err = transfer(false, startRegister, dest, (uint8_t)len);
+
+  if (err != VEML7700_ERROR_SUCCESS)
+  {
+#ifndef VEML7700_DISABLE_DEBUG
+    if (_debugEnabled) _debugPort->println(F("VEML7700::readI2CBuffer: transport read error"));
+#endif
+    return err;
+  }
+
+  // Keep the debug messages out of the byte loop
+#ifndef VEML7700_DISABLE_DEBUG
+  if (_debugEnabled)
+  {
+    _debugPort->print(F("VEML7700::readI2CBuffer: register: 0x"));
+    _debugPort->println(startRegister, HEX);
+    _debugPort->print(F("VEML7700::readI2CBuffer: device returned:"));
+    for (uint16_t i = 0; i < len; i++)
+    {
+      _debugPort->print(F(" 0x"));
+      _debugPort->print(dest[i], HEX);
+    }
+    _debugPort->println(F(""));
+  }
+#endif
+
+  return VEML7700_ERROR_SUCCESS;
+}
+
+VEML7700_error_t VEML7700::readI2CRegisters(VEML7700_t *dest, VEML7700_registers_t firstRegister, uint8_t count)
+{
+  /** The VEML7700 does not auto-increment the register address. Each register needs
+      its own command code and repeated start. Issue the transactions back-to-back,
+      and leave any debug messages until they are all complete. */
+  for (uint8_t r = 0; r < count; r++)
+  {
+    uint8_t buffer[VEML7700_REGISTER_LENGTH];
+    // Each transaction is locked separately, so other tasks can use the bus in between
+    VEML7700_error_t err = transfer(false, (uint8_t)(firstRegister + r), buffer, VEML7700_REGISTER_LENGTH);
+
+    if (err != VEML7700_ERROR_SUCCESS)
+    {
+#ifndef VEML7700_DISABLE_DEBUG
+      if (_debugEnabled) _debugPort->println(F("VEML7700::readI2CRegisters: transport read error"));
+#endif
+      return err;
+    }
+
+    dest[r] = ((VEML7700_t)buffer[0]) | (((VEML7700_t)buffer[1]) << 8);
+  }
+
+#ifndef VEML7700_DISABLE_DEBUG
+  if (_debugEnabled)
+  {
+    _debugPort->print(F("VEML7700::readI2CRegisters: register: 0x"));
+    _debugPort->print(firstRegister, HEX);
+    _debugPort->print(F(" device returned:"));
+    for (uint8_t r = 0; r < count; r++)
+    {
+      _debugPort->print(F(" 0x"));
+      _debugPort->print(dest[r], HEX);
+    }
+    _debugPort->println(F(""));
+  }
+#endif
+
+  return VEML7700_ERROR_SUCCESS;
+}
+
+VEML7700_error_t VEML7700::writeI2CBuffer(uint8_t *src, VEML7700_registers_t startRegister, uint16_t len)
+{
+  return (transfer(true, startRegister, src, (uint8_t)len));
+}
+
+VEML7700_error_t VEML7700::transfer(bool write, uint8_t reg, uint8_t *data, uint8_t len)
+{
+  VEML7700_error_t err = VEML7700_ERROR_UNDEFINED;
+
+  if (_transport == NULL)
+    return VEML7700_ERROR_UNDEFINED;
+
+  for (uint8_t attempt = 0; attempt <= _retries; attempt++)
+  {
+    if (attempt > 0)
+    {
+      // Back off before each retry: backoff, 2 * backoff, 4 * backoff, ...
+      unsigned long backoff = (unsigned long)_retryBackoffMicros << (attempt - 1);
+      if (backoff >= 1000)
+        delay(backoff / 1000);
+      delayMicroseconds((unsigned int)(backoff % 1000));
+    }
+
+    // Lock each attempt separately, so other tasks can use the bus during the back off
+    if (!lockBus())
+      return VEML7700_ERROR_BUSY;
+
+    // Two failures in a row: the bus may be stuck (e.g. a slave holding SDA low)
+    if ((attempt > 1) && (_busRecovery != NULL))
+      _busRecovery(_busRecoveryContext);
+
+#ifdef VEML7700_ENABLE_BUS_STATS
+    unsigned long startMicros = micros();
+#endif
+    if (write)
+      err = _transport->write(_deviceAddress, reg, data, len);
+    else
+      err = _transport->read(_deviceAddress, reg, data, len);
+#ifdef VEML7700_ENABLE_BUS_STATS
+    recordTransaction(write, len, err, startMicros);
+#endif
+    unlockBus();
+
+    // Only retry bus errors. A retry will not fix the others
+    if ((err != VEML7700_ERROR_READ) && (err != VEML7700_ERROR_WRITE))
+      break;
+
+#ifndef VEML7700_DISABLE_DEBUG
+    if (_debugEnabled && (attempt < _retries))
+    {
+      _debugPort->print(F("VEML7700::transfer: bus error. Retrying register 0x"));
+      _debugPort->println(reg, HEX);
+    }
+#endif
+  }
+
+  return (err);
+}
+
+#ifdef VEML7700_ENABLE_BUS_STATS
+void VEML7700::recordTransaction(bool write, uint8_t len, VEML7700_error_t err, unsigned long startMicros)
+{
+  unsigned long elapsed = micros() - startMicros;
+
+  if (write)
+    _stats.writes++;
+  else
+    _stats.reads++;
+  _stats.bytes += 1 + len; // The command code, then the data
+
+  if (err != VEML7700_ERROR_SUCCESS)
+  {
+    if ((err == VEML7700_ERROR_READ) || (err == VEML7700_ERROR_WRITE))
+      _stats.nacks++;
+    int index = -1 - (int)err; // VEML7700_ERROR_UNDEFINED (-1) is 0
+    if ((index >= 0) && (index < VEML7700_NUM_ERROR_CODES))
+      _stats.errors[index]++;
+  }
+
+  _totalMicros += elapsed;
+  if (elapsed < _stats.minMicros)
+    _stats.minMicros = elapsed;
+  if (elapsed > _stats.maxMicros)
+    _stats.maxMicros = elapsed;
+}
+#endif
+
+VEML7700_error_t VEML7700::readI2CRegister(VEML7700_t *dest, VEML7700_registers_t registerAddress)
+{
+  VEML7700_error_t err;
+  uint8_t tempDest[2];
+  err = readI2CBuffer(tempDest, registerAddress, VEML7700_REGISTER_LENGTH);
+  if (err == VEML7700_ERROR_SUCCESS)
+  {
+    *dest = (tempDest[0]) | ((VEML7700_t)tempDest[1] << 8);
+  }
+  return err;
+}
+
+VEML7700_error_t VEML7700::writeI2CRegister(VEML7700_t data, VEML7700_registers_t registerAddress)
+{
+  uint8_t d[2];
+  // Write LSB first
+  d[0] = (uint8_t)(data & 0x00FF);
+  d[1] = (uint8_t)((data & 0xFF00) >> 8);
+  VEML7700_error_t err = writeI2CBuffer(d, registerAddress, VEML7700_REGISTER_LENGTH);
+
+  // Remember what was written, so it can be restored if the sensor is reset unexpectedly
+  if (err == VEML7700_ERROR_SUCCESS)
+  {
+    switch (registerAddress)
+    {
+      case VEML7700_CONFIGURATION_REGISTER:
+        _appliedConfiguration = data;
+        break;
+      case VEML7700_HIGH_THRESHOLD:
+        _appliedHighThreshold = data;
+        break;
+      case VEML7700_LOW_THRESHOLD:
+        _appliedLowThreshold = data;
+        break;
+      case VEML7700_POWER_SAVING:
+        _appliedPowerSave = data;
+        break;
+      default:
+        return (err);
+    }
+    _appliedRegisters |= (uint8_t)(1 << registerAddress);
+  }
+
+  return (err);
+}
+
+VEML7700_error_t VEML7700::pollAmbientLight(uint16_t *ambient)
+{
+  VEML7700_error_t err;
+
+  if (!isMeasurementReady())
+    return (VEML7700_ERROR_NOT_READY);
+
+  // With the configuration cache enabled, check for an unexpected reset every _resetCheckInterval
+  if (_resetRecovery && (_resetCheckInterval > 0) && ((millis() - _lastResetCheck) >= _resetCheckInterval))
+  {
+    err = checkConfiguration();
+
+    if (err != VEML7700_ERROR_SUCCESS)
+      return (err);
+
+    if (!isMeasurementReady())
+      return (VEML7700_ERROR_NOT_READY); // The configuration was restored. Wait for a new conversion
+  }
+
+  err = readConfigurationRegister(); // Gain and integration time. Does nothing if the shadow is valid.
+
+  if (err != VEML7700_ERROR_SUCCESS)
+    return (err);
+
+  err = getAmbientLight(ambient);
+
+  if (err != VEML7700_ERROR_SUCCESS)
+    return (err);
+
+  /** Step on to the next conversion which has not been read yet.
+      (If poll was called late, some conversions will have been missed.) */
+  unsigned long late = millis() - _nextSampleMillis;
+  _nextSampleMillis += ((late / _measurementPeriod) + 1) * _measurementPeriod;
+
+  if (_autoRange)
+  {
+    if (_autoRangeConversions < 0xFF)
+      _autoRangeConversions++;
+
+    /** Change the range if the count is outside the hysteresis band.
+        The configuration write restarts the timer, so the next poll will wait for
+        a conversion using the new range. */
+    err = autoRangeStep(*ambient);
+
+    if (err != VEML7700_ERROR_SUCCESS)
+      return (err); // VEML7700_ERROR_NOT_READY if the range was changed
+
+    _lastAutoRangeConversions = _autoRangeConversions;
+    _autoRangeConversions = 0;
+  }
+
+  /** Check for saturation. With VEML7700_SATURATION_RETRY, this changes the range and returns
+      VEML7700_ERROR_NOT_READY. Bad samples are not passed on to the buffer or statistics. */
+  err = checkSampleQuality(ambient, false);
+
+  if (err != VEML7700_ERROR_SUCCESS)
+    return (err);
+
+  VEML7700_sensitivity_mode_t sm = (VEML7700_sensitivity_mode_t)_configurationRegister.CONFIG_REG_SM;
+  VEML7700_integration_time_t it = integrationTimeFromConfig((VEML7700_config_integration_time_t)_configurationRegister.CONFIG_REG_IT);
+
+  if (_sampleBuffer != NULL)
+    _sampleBuffer->push(*ambient, sm, it);
+
+  if (_statistics != NULL)
+    _statistics->add(*ambient, sm, it);
+
+  if (_sinkCount > 0)
+    publish(*ambient);
+
+  return (VEML7700_ERROR_SUCCESS);
+}
+
+void VEML7700::publish(uint16_t ambient)
+{
+  float lux = luxFromAmbient(ambient); // Once, for every sink
+
+  for (uint8_t i = 0; i < _sinkCount; i++)
+  {
+    VEML7700_sink_t *sink = &_sinks[i];
+
+    if (++sink->count < sink->decimation)
+      continue;
+    sink->count = 0;
+
+    if (sink->published && (sink->changeThresholdLux > 0.0) && (fabs(lux - sink->lastLux) < sink->changeThresholdLux))
+      continue; // Not enough change
+
+    sink->lastLux = lux;
+    sink->published = true;
+    sink->callback(ambient, lux, sink->context);
+  }
+}
+
+float VEML7700::correctLux(float lux)
+{
+  if (lux <= VEML7700_CORRECTION_THRESHOLD_LUX)
+    return (lux);
+
+  // Horner form: lux * (c1 + lux * (c2 + lux * (c3 + lux * c4)))
+  float result = pgm_read_float(&VEML7700_CORRECTION_COEFFICIENTS[3]);
+  result = pgm_read_float(&VEML7700_CORRECTION_COEFFICIENTS[2]) + (lux * result);
+  result = pgm_read_float(&VEML7700_CORRECTION_COEFFICIENTS[1]) + (lux * result);
+  result = pgm_read_float(&VEML7700_CORRECTION_COEFFICIENTS[0]) + (lux * result);
+  return (lux * result);
+}
+
+uint32_t VEML7700::correctMilliLux(uint32_t milliLux)
+{
+  if (milliLux <= ((uint32_t)VEML7700_CORRECTION_THRESHOLD_LUX * 1000))
+    return (milliLux);
+
+  /** The polynomial is only valid up to the full scale of the sensor (65535 counts at the
+      least sensitive range). Clamp to that: beyond it, milliLux * result would overflow 64 bits. */
+  if (milliLux > VEML7700_CORRECTION_MAX_MILLILUX)
+    milliLux = VEML7700_CORRECTION_MAX_MILLILUX;
+
+  /** Evaluate the polynomial in kilolux, in Q16 format: milliLux * 65536 / 1000000.
+      The maximum is about 121 kilolux, so the Horner steps stay well inside 64 bits. */
+  int64_t kiloLux = ((int64_t)milliLux * 4295) >> 16; // 4295 / 65536 = 65536 / 1000000 (+0.001%)
+
+  // Horner form, in Q24: c1 + kiloLux * (c2 + kiloLux * (c3 + kiloLux * c4))
+  int64_t result = (int32_t)pgm_read_dword(&VEML7700_CORRECTION_COEFFICIENTS_Q24[3]);
+  result = (int32_t)pgm_read_dword(&VEML7700_CORRECTION_COEFFICIENTS_Q24[2]) + ((result * kiloLux) >> 16);
+  result = (int32_t)pgm_read_dword(&VEML7700_CORRECTION_COEFFICIENTS_Q24[1]) + ((result * kiloLux) >> 16);
+  result = (int32_t)pgm_read_dword(&VEML7700_CORRECTION_COEFFICIENTS_Q24[0]) + ((result * kiloLux) >> 16);
+
+  result = ((int64_t)milliLux * result) >> 24;
+
+  if (result > (int64_t)0xFFFFFFFF)
+    return (0xFFFFFFFF);
+  return ((uint32_t)result);
+}
+
+float VEML7700::luxFromAmbient(uint16_t ambient)
+{
+  return (luxFromCounts((float)ambient));
+}
+
+float VEML7700::luxFromCounts(float ambient)
+{
+  /** The resolution and calibration gain are folded together when the configuration or
+      calibration changes. So this is a single multiply-add, plus one for the table. */
+  if (!_luxResolutionValid)
+  {
+    VEML7700_sensitivity_mode_t sm = (VEML7700_sensitivity_mode_t)_configurationRegister.CONFIG_REG_SM;
+    VEML7700_integration_time_t it = integrationTimeFromConfig((VEML7700_config_integration_time_t)_configurationRegister.CONFIG_REG_IT);
+
+    // Fold the calibration gain into the resolution: lux = (ambient * resolution * gain) + offset
+    if ((sm >= VEML7700_SENSITIVITY_INVALID) || (it >= VEML7700_INTEGRATION_INVALID))
+      _luxResolution = 0.0;
+    else
+      _luxResolution = pgm_read_float(&VEML7700_LUX_RESOLUTION[sm][it]) * _calibrationGain;
+    _luxResolutionValid = true;
+  }
+
+  if (_luxResolution == 0.0)
+    return (0.0); // Invalid configuration
+
+  return (applyCalibrationTable((ambient * _luxResolution) + _calibrationOffset));
+}
+
+float VEML7700::applyCalibrationTable(float lux)
+{
+  if (_calibrationPoints > 0)
+  {
+    uint8_t segment = 0;
+    while ((segment < (_calibrationPoints - 2)) && (lux >= _calibrationTable[segment + 1].lux))
+      segment++;
+    lux = _tableIntercept[segment] + (lux * _tableSlope[segment]);
+  }
+
+  return ((lux < 0.0) ? 0.0 : lux);
+}
+
+uint32_t VEML7700::applyCalibrationTableMilli(int64_t milliLux)
+{
+  if (_calibrationPoints > 0)
+  {
+    // Clamp to the output range first, so that the multiply stays inside 64 bits
+    if (milliLux > (int64_t)0xFFFFFFFF)
+      milliLux = (int64_t)0xFFFFFFFF;
+    else if (milliLux < -(int64_t)0xFFFFFFFF)
+      milliLux = -(int64_t)0xFFFFFFFF;
+
+    uint8_t segment = 0;
+    while ((segment < (_calibrationPoints - 2)) && (milliLux >= _tableBreakMilli[segment]))
+      segment++;
+    milliLux = (((milliLux * _tableSlopeQ16[segment]) + 0x8000) >> 16) + _tableInterceptMilli[segment];
+  }
+
+  if (milliLux < 0)
+    return (0);
+  if (milliLux > (int64_t)0xFFFFFFFF)
+    return (0xFFFFFFFF);
+  return ((uint32_t)milliLux);
+}
+
+void VEML7700::updateResolution()
+{
+  VEML7700_sensitivity_mode_t sm = (VEML7700_sensitivity_mode_t)_configurationRegister.CONFIG_REG_SM;
+  VEML7700_integration_time_t it = integrationTimeFromConfig((VEML7700_config_integration_time_t)_configurationRegister.CONFIG_REG_IT);
+
+  _calibrated = (_calibrationGainQ16 != VEML7700_CALIBRATION_UNITY_Q16) || (_calibrationOffsetMilli != 0) || (_calibrationPoints > 0);
+
+  /** This runs on every configuration read and write, so it must not use floating point:
+      that would pull the float library into builds which only use the integer (millilux) path.
+      The float resolution is recalculated by luxFromCounts, the first time it is needed. */
+  _luxResolutionValid = false;
+
+  if ((sm >= VEML7700_SENSITIVITY_INVALID) || (it >= VEML7700_INTEGRATION_INVALID))
+  {
+    _milliResolutionQ16 = 0;
+    _correctionCounts = 0xFFFF;
+    return;
+  }
+
+  uint16_t resolutionx10000 = pgm_read_word(&VEML7700_LUX_RESOLUTION_x10000[sm][it]);
+
+  // Q16 millilux per count: (0.0001 lux per count / 10) * gain
+  uint64_t resolution = ((((uint64_t)resolutionx10000 * _calibrationGainQ16)) + 5) / 10;
+  _milliResolutionQ16 = (resolution > 0xFFFFFFFF) ? 0xFFFFFFFF : (uint32_t)resolution;
+
+  /** The largest count whose (rounded) datasheet millilux is at or below the correction threshold:
+      ((ambient * resolutionx10000) + 5) / 10 <= threshold * 1000 */
+  uint32_t counts = (((uint32_t)VEML7700_CORRECTION_THRESHOLD_LUX * 10000) + 4) / resolutionx10000;
+  _correctionCounts = (counts > 0xFFFF) ? 0xFFFF : (uint16_t)counts;
+}
+
+uint16_t VEML7700::ambientFromLux(float lux)
+{
+  VEML7700_sensitivity_mode_t sm = (VEML7700_sensitivity_mode_t)_configurationRegister.CONFIG_REG_SM;
+  VEML7700_integration_time_t it = integrationTimeFromConfig((VEML7700_config_integration_time_t)_configurationRegister.CONFIG_REG_IT);
+
+  if ((sm >= VEML7700_SENSITIVITY_INVALID) || (it >= VEML7700_INTEGRATION_INVALID))
+    return (0);
+
+  // Undo the calibration: the thresholds are compared with the raw count
+  if (_calibrationPoints > 0)
+  {
+    // The table is monotonic, so find the segment from the calibrated lux (the first and last are extended)
+    uint8_t segment = 0;
+    while ((segment < (_calibrationPoints - 2)) && (lux >= _calibrationTable[segment + 1].calibratedLux))
+      segment++;
+    const VEML7700_calibration_point_t *p = &_calibrationTable[segment];
+    lux = p[0].lux + ((lux - p[0].calibratedLux) * (p[1].lux - p[0].lux) / (p[1].calibratedLux - p[0].calibratedLux));
+  }
+  lux = (lux - _calibrationOffset) / _calibrationGain;
+  if (lux < 0.0)
+    lux = 0.0;
+
+  float ambient = (lux / pgm_read_float(&VEML7700_LUX_RESOLUTION[sm][it])) + 0.5;
+
+  if (ambient >= 65535.0)
+    return (0xFFFF);
+  return ((uint16_t)ambient);
+}
+
+VEML7700_error_t VEML7700::writeLuxThresholds()
+{
+  /** Use the gain and integration time from the shadow copy. Don't read it back here:
+      writeConfigurationRegister calls this straight after writing it, and a read could
+      recurse through the reset recovery (restoreConfiguration). */
+  VEML7700_error_t err = VEML7700_ERROR_SUCCESS;
+
+  if (_highThresholdLux >= 0.0)
+    err = writeI2CRegister((VEML7700_t)ambientFromLux(_highThresholdLux), VEML7700_HIGH_THRESHOLD);
+
+  if ((err == VEML7700_ERROR_SUCCESS) && (_lowThresholdLux >= 0.0))
+    err = writeI2CRegister((VEML7700_t)ambientFromLux(_lowThresholdLux), VEML7700_LOW_THRESHOLD);
+
+  // If a write failed, force a rewrite on the next configuration write
+  if (err == VEML7700_ERROR_SUCCESS)
+    _thresholdRange = _configurationRegister.all & VEML7700_CONFIG_RANGE_BITS;
+  else
+    _thresholdRange = (VEML7700_t)~VEML7700_CONFIG_RANGE_BITS;
+
+#ifndef VEML7700_DISABLE_DEBUG
+  if (_debugEnabled)
+  {
+    _debugPort->print(F("VEML7700::writeLuxThresholds: err: "));
+    _debugPort->println(err);
+  }
+#endif
+
+  return (err);
+}
+
+uint32_t VEML7700::milliLuxFromAmbient(uint16_t ambient)
+{
+  VEML7700_sensitivity_mode_t sm = (VEML7700_sensitivity_mode_t)_configurationRegister.CONFIG_REG_SM;
+  VEML7700_integration_time_t it = integrationTimeFromConfig((VEML7700_config_integration_time_t)_configurationRegister.CONFIG_REG_IT);
+
+  if ((sm >= VEML7700_SENSITIVITY_INVALID) || (it >= VEML7700_INTEGRATION_INVALID))
+    return (0);
+
+  /** ambient * resolution is at most 65535 * 18432, which fits in 32 bits.
+      Divide by 10 (with rounding) to convert from 0.0001 lux to millilux. */
+  uint32_t resolution = pgm_read_word(&VEML7700_LUX_RESOLUTION_x10000[sm][it]);
+  if (!_calibrated)
+    return ((((uint32_t)ambient * resolution) + 5) / 10);
+
+  // Calibrated: a fixed-point multiply-shift with the folded resolution (see updateResolution)
+  return (applyCalibrationTableMilli((int64_t)((((uint64_t)ambient * _milliResolutionQ16) + 0x8000) >> 16) + _calibrationOffsetMilli));
+}
+
+uint8_t VEML7700::rangeCell()
+{
+  /** Find the ladder cell with the same resolution as the current configuration.
+      The configuration may not be on the ladder (e.g. x1 at 100ms). If so, use the
+      cell with the nearest resolution. */
+  VEML7700_sensitivity_mode_t sm = (VEML7700_sensitivity_mode_t)_configurationRegister.CONFIG_REG_SM;
+  VEML7700_integration_time_t it = integrationTimeFromConfig((VEML7700_config_integration_time_t)_configurationRegister.CONFIG_REG_IT);
+
+  if ((sm >= VEML7700_SENSITIVITY_INVALID) || (it >= VEML7700_INTEGRATION_INVALID))
+    return (0);
+
+  uint16_t resolution = pgm_read_word(&VEML7700_LUX_RESOLUTION_x10000[sm][it]);
+  uint8_t cell = 0;
+
+  while ((cell < (VEML7700_NUM_RANGE_CELLS - 1))
+         && (rangeCellResolution(cell + 1) >= resolution))
+    cell++;
+
+  return (cell);
+}
+
+uint16_t VEML7700::rangeCellResolution(uint8_t cell)
+{
+  return (pgm_read_word(&VEML7700_LUX_RESOLUTION_x10000[pgm_read_byte(&VEML7700_RANGE_LADDER[cell][0])][pgm_read_byte(&VEML7700_RANGE_LADDER[cell][1])]));
+}
+
+VEML7700_error_t VEML7700::setRangeCell(uint8_t cell)
+{
+  _configurationRegister.CONFIG_REG_SM = (VEML7700_t)pgm_read_byte(&VEML7700_RANGE_LADDER[cell][0]);
+  _configurationRegister.CONFIG_REG_IT = (VEML7700_t)integrationTimeConfig((VEML7700_integration_time_t)pgm_read_byte(&VEML7700_RANGE_LADDER[cell][1]));
+
+#ifndef VEML7700_DISABLE_DEBUG
+  if (_debugEnabled)
+  {
+    _debugPort->print(F("VEML7700::setRangeCell: gain: "));
+    _debugPort->print(VEML7700_flashString(VEML7700_GAIN_SETTINGS, pgm_read_byte(&VEML7700_RANGE_LADDER[cell][0])));
+    _debugPort->print(F(" integration time: "));
+    _debugPort->println(VEML7700_flashString(VEML7700_INTEGRATION_TIMES, pgm_read_byte(&VEML7700_RANGE_LADDER[cell][1])));
+  }
+#endif
+
+  return (writeConfigurationRegister());
+}
+
+VEML7700_error_t VEML7700::autoRangeStep(uint16_t ambient)
+{
+  VEML7700_error_t err;
+  uint8_t cell = rangeCell();
+  uint8_t target;
+
+  if ((ambient >= _autoRangeLow) && (ambient <= _autoRangeHigh))
+    return (VEML7700_ERROR_SUCCESS); // In the band
+
+  if (ambient == 0xFFFF)
+  {
+    /** Saturated. We can't predict the lux, only that it is at least 0xFFFF * resolution.
+        Jump straight to the least sensitive cell. It uses the shortest integration time
+        so the extra conversion is as cheap as possible. */
+    target = 0;
+  }
+  else if (ambient == 0)
+  {
+    /** No light. All we know is that the lux is below the resolution.
+        Jump straight to the most sensitive cell. */
+    target = VEML7700_NUM_RANGE_CELLS - 1;
+  }
+  else
+  {
+    /** Predict the count for each cell from the ratio of the resolutions, and jump
+        to the most sensitive cell which will not exceed the high threshold.
+        Use (ambient + 1) to allow for the quantization of small counts.
+        The ratio between adjacent cells is at most 4, so the target count is
+        at least _autoRangeHigh / 4. This is inside the band (if high >= 4 * low)
+        unless we reach the most sensitive cell. */
+    uint32_t lux = ((uint32_t)ambient + 1) * rangeCellResolution(cell); // Units of 0.0001 lux. Fits in 32 bits.
+    target = 0;
+    while ((target < (VEML7700_NUM_RANGE_CELLS - 1))
+           && ((lux / rangeCellResolution(target + 1)) <= _autoRangeHigh))
+      target++;
+  }
+
+  if (target == cell)
+    return (VEML7700_ERROR_SUCCESS); // We are already at the end of the ladder
+
+  err = setRangeCell(target);
+
+  if (err != VEML7700_ERROR_SUCCESS)
+    return (err);
+
+  return (VEML7700_ERROR_NOT_READY);
+}
+
+VEML7700_sample_quality_t VEML7700::sampleQuality(uint16_t ambient)
+{
+  VEML7700_sensitivity_mode_t sm = (VEML7700_sensitivity_mode_t)_configurationRegister.CONFIG_REG_SM;
+  VEML7700_integration_time_t it = integrationTimeFromConfig((VEML7700_config_integration_time_t)_configurationRegister.CONFIG_REG_IT);
+
+  if ((sm >= VEML7700_SENSITIVITY_INVALID) || (it >= VEML7700_INTEGRATION_INVALID))
+    return (VEML7700_SAMPLE_INVALID);
+
+  if (ambient == 0xFFFF)
+    return (VEML7700_SAMPLE_SATURATED);
+
+  // Low counts are only under range if a more sensitive range is available
+  if ((ambient < VEML7700_UNDERRANGE_COUNTS)
+      && (pgm_read_word(&VEML7700_LUX_RESOLUTION_x10000[sm][it]) > VEML7700_BASE_RESOLUTION_x10000))
+    return (VEML7700_SAMPLE_UNDERRANGE);
+
+  return (VEML7700_SAMPLE_VALID);
+}
+
+VEML7700_error_t VEML7700::checkSampleQuality(uint16_t *ambient, bool blocking)
+{
+  VEML7700_error_t err;
+
+  _sampleQuality = sampleQuality(*ambient);
+
+  if ((_sampleQuality == VEML7700_SAMPLE_VALID) || (_saturationHandling == VEML7700_SATURATION_IGNORE))
+    return (VEML7700_ERROR_SUCCESS);
+
+  if (_saturationHandling == VEML7700_SATURATION_RETRY)
+  {
+    /** Use the auto-range prediction to jump to a better range. autoRangeStep returns
+        VEML7700_ERROR_NOT_READY if the range was changed, VEML7700_ERROR_SUCCESS if we are
+        already at the end of the ladder. */
+    for (uint8_t retry = 0; (retry < VEML7700_MAX_QUALITY_RETRIES) && (_sampleQuality != VEML7700_SAMPLE_VALID); retry++)
+    {
+      err = autoRangeStep(*ambient);
+
+      if (err == VEML7700_ERROR_SUCCESS)
+        break; // No better range
+
+      if (err != VEML7700_ERROR_NOT_READY)
+        return (err);
+
+      if (!blocking)
+        return (VEML7700_ERROR_NOT_READY); // poll will wait for a conversion with the new range
+
+      if (_configurationRegister.CONFIG_REG_SD)
+        break; // Shut down. There will be no new conversion
+
+      // Wait for a conversion with the new range. The configuration write restarted the integration
+      delay(VEML7700_POWER_ON_DELAY_ms + measurementPeriodMillis(integrationTimeFromConfig((VEML7700_config_integration_time_t)_configurationRegister.CONFIG_REG_IT)));
+
+      err = getAmbientLight(ambient);
+
+      if (err != VEML7700_ERROR_SUCCESS)
+      {
+        _sampleQuality = VEML7700_SAMPLE_INVALID;
+        return (err);
+      }
+
+      _sampleQuality = sampleQuality(*ambient);
+    }
+
+#ifndef VEML7700_DISABLE_DEBUG
+    if (_debugEnabled)
+    {
+      _debugPort->print(F("VEML7700::checkSampleQuality: retried. quality: "));
+      _debugPort->println(_sampleQuality);
+    }
+#endif
+
+    if (_sampleQuality == VEML7700_SAMPLE_VALID)
+      return (VEML7700_ERROR_SUCCESS);
+  }
+
+  if (_sampleQuality == VEML7700_SAMPLE_SATURATED)
+    return (VEML7700_ERROR_SATURATED);
+  if (_sampleQuality == VEML7700_SAMPLE_UNDERRANGE)
+    return (VEML7700_ERROR_UNDERRANGE);
+  return (VEML7700_ERROR_UNDEFINED);
+}
+
+VEML7700_error_t VEML7700::readConfigurationRegister()
+{
+  VEML7700_error_t err;
+
+  // Use the shadow copy if we can trust it
+  if (_cacheConfiguration && _configurationValid)
+    return VEML7700_ERROR_SUCCESS;
+
+  // Compare the configuration with what we last wrote, if reset recovery is enabled
+  if (_resetRecovery)
+    return (checkConfiguration());
+
+  err = readI2CRegister((VEML7700_t *)&_configurationRegister, VEML7700_CONFIGURATION_REGISTER);
+  _configurationValid = (err == VEML7700_ERROR_SUCCESS);
+  updateResolution();
+  return err;
+}
+
+VEML7700_error_t VEML7700::restoreConfiguration()
+{
+  VEML7700_error_t err = VEML7700_ERROR_SUCCESS;
+
+  if (_resetCount < 0xFFFF)
+    _resetCount++;
+
+#ifndef VEML7700_DISABLE_DEBUG
+  if (_debugEnabled)
+    _debugPort->println(F("VEML7700::restoreConfiguration: unexpected configuration. Restoring the registers"));
+#endif
+
+  /** Write the power saving mode and thresholds first. The configuration write
+      then restarts the integration (and the measurement timer) with everything in place. */
+  if (_appliedRegisters & (1 << VEML7700_POWER_SAVING))
+  {
+    _powerSaveRegister.all = _appliedPowerSave;
+    err = writePowerSaveRegister();
+  }
+
+  if ((err == VEML7700_ERROR_SUCCESS) && (_appliedRegisters & (1 << VEML7700_HIGH_THRESHOLD)))
+    err = writeI2CRegister(_appliedHighThreshold, VEML7700_HIGH_THRESHOLD);
+
+  if ((err == VEML7700_ERROR_SUCCESS) && (_appliedRegisters & (1 << VEML7700_LOW_THRESHOLD)))
+    err = writeI2CRegister(_appliedLowThreshold, VEML7700_LOW_THRESHOLD);
+
+  if (err == VEML7700_ERROR_SUCCESS)
+  {
+    _configurationRegister.all = _appliedConfiguration;
+    err = writeConfigurationRegister();
+  }
+  else
+    _configurationValid = false;
+
+  return (err);
+}
+
+VEML7700_error_t VEML7700::writeConfigurationRegister()
+{
+  VEML7700_error_t err;
+
+  err = writeI2CRegister(_configurationRegister.all, VEML7700_CONFIGURATION_REGISTER);
+  // If the write failed, we no longer know what the sensor is using. Force a re-read next time.
+  _configurationValid = (err == VEML7700_ERROR_SUCCESS);
+  updateResolution();
+
+  /** If the gain or integration time has changed, rescale the lux thresholds.
+      Writing the configuration restarts the integration, so the new thresholds are in place
+      well before the first conversion with the new range completes. */
+  if ((err == VEML7700_ERROR_SUCCESS) && ((_highThresholdLux >= 0.0) || (_lowThresholdLux >= 0.0))
+      && ((_configurationRegister.all & VEML7700_CONFIG_RANGE_BITS) != _thresholdRange))
+    err = writeLuxThresholds();
+
+  // Writing the configuration restarts the integration
+  if (_measurementActive)
+    restartMeasurementTimer();
+
+  return err;
+}
+
+VEML7700_error_t VEML7700::readPowerSaveRegister()
+{
+  VEML7700_error_t err;
+
+  // Use the shadow copy if we can trust it
+  if (_cacheConfiguration && _powerSaveValid)
+    return VEML7700_ERROR_SUCCESS;
+
+  err = readI2CRegister((VEML7700_t *)&_powerSaveRegister, VEML7700_POWER_SAVING);
+  _powerSaveValid = (err == VEML7700_ERROR_SUCCESS);
+  return err;
+}
+
+VEML7700_error_t VEML7700::writePowerSaveRegister()
+{
+  VEML7700_error_t err;
+
+  err = writeI2CRegister(_powerSaveRegister.all, VEML7700_POWER_SAVING);
+  _powerSaveValid = (err == VEML7700_ERROR_SUCCESS);
+
+  // The refresh time has changed
+  if (_measurementActive)
+    restartMeasurementTimer();
+
+  return err;
+}
+
+void VEML7700::restartMeasurementTimer()
+{
+  if (_configurationRegister.CONFIG_REG_SD == VEML7700_SHUT_DOWN)
+  {
+    _measurementActive = false; // No more conversions until startMeasurement is called again
+    return;
+  }
+
+  /** Use the settings from the shadow copy. Don't call getMeasurementPeriodMillis here
+      as that could read the configuration register. */
+  _measurementPeriod = measurementPeriodMillis(integrationTimeFromConfig((VEML7700_config_integration_time_t)_configurationRegister.CONFIG_REG_IT));
+  _nextSampleMillis = millis() + VEML7700_POWER_ON_DELAY_ms + _measurementPeriod;
+}
+
+unsigned long VEML7700::measurementPeriodMillis(VEML7700_integration_time_t it)
+{
+  if (it >= VEML7700_INTEGRATION_INVALID)
+    it = VEML7700_INTEGRATION_800ms; // Be conservative
+
+  unsigned long period = pgm_read_word(&VEML7700_INTEGRATION_TIMES_ms[it]);
+
+  // In power saving mode, the refresh time is the integration time plus the PSM wait time
+  if (_powerSaveRegister.POWER_SAVE_REG_PSM_EN == VEML7700_POWER_SAVE_ENABLE)
+    period += pgm_read_word(&VEML7700_POWER_SAVE_WAIT_ms[_powerSaveRegister.POWER_SAVE_REG_PSM]);
+
+  period += (period * VEML7700_SETTLING_MARGIN_PERCENT) / 100;
+  return (period);
+}
+
+VEML7700::VEML7700_config_integration_time_t VEML7700::integrationTimeConfig(VEML7700_integration_time_t it)
+{
+  switch (it)
+  {
+    case VEML7700_INTEGRATION_25ms:
+      return (VEML7700_CONFIG_INTEGRATION_25ms);
+      break;
+    case VEML7700_INTEGRATION_50ms:
+      return (VEML7700_CONFIG_INTEGRATION_50ms);
+      break;
+    case VEML7700_INTEGRATION_100ms:
+      return (VEML7700_CONFIG_INTEGRATION_100ms);
+      break;
+    case VEML7700_INTEGRATION_200ms:
+      return (VEML7700_CONFIG_INTEGRATION_200ms);
+      break;
+    case VEML7700_INTEGRATION_400ms:
+      return (VEML7700_CONFIG_INTEGRATION_400ms);
+      break;
+    case VEML7700_INTEGRATION_800ms:
+      return (VEML7700_CONFIG_INTEGRATION_800ms);
+      break;
+    default:
+      break;
+  }
+  return (VEML7700_CONFIG_INTEGRATION_INVALID);
+}
+
+VEML7700_integration_time_t VEML7700::integrationTimeFromConfig(VEML7700::VEML7700_config_integration_time_t it)
+{
+  switch (it)
+  {
+    case VEML7700_CONFIG_INTEGRATION_25ms:
+      return (VEML7700_INTEGRATION_25ms);
+      break;
+    case VEML7700_CONFIG_INTEGRATION_50ms:
+      return (VEML7700_INTEGRATION_50ms);
+      break;
+    case VEML7700_CONFIG_INTEGRATION_100ms:
+      return (VEML7700_INTEGRATION_100ms);
+      break;
+    case VEML7700_CONFIG_INTEGRATION_200ms:
+      return (VEML7700_INTEGRATION_200ms);
+      break;
+    case VEML7700_CONFIG_INTEGRATION_400ms:
+      return (VEML7700_INTEGRATION_400ms);
+      break;
+    case VEML7700_CONFIG_INTEGRATION_800ms:
+      return (VEML7700_INTEGRATION_800ms);
+      break;
+    default:
+      break;
+  }
+  return (VEML7700_INTEGRATION_INVALID);
+}
+
+VEML7700ArrayBase::VEML7700ArrayBase(VEML7700 *sensors, uint8_t *channels, uint8_t *order, bool *failed, uint8_t capacity,
+                                     VEML7700_mux_select_t muxSelect, void *context)
+{
+  // Note: the storage has not been constructed yet. Only store the pointers here.
+  _sensors = sensors;
+  _channels = channels;
+  _order = order;
+  _failed = failed;
+  _wirePort = NULL;
+  _transport = NULL;
+  _capacity = capacity;
+  _numSensors = 0;
+  _muxSelect = muxSelect;
+  _muxContext = context;
+  _selectedChannel = -1;
+  _reverse = false;
+  _sweepStarted = false;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Add a sensor to the array
+    @param  channel
+            <br>The mux channel the sensor is connected to. This is passed to the
+            <br>mux select callback. It can encode the mux address as well as the channel.
+    @return The index of the sensor, or 0xFF if the array is full
+*/
+/**************************************************************************/
+uint8_t VEML7700ArrayBase::addSensor(uint8_t channel)
+{
+  if (_numSensors >= _capacity)
+    return (0xFF);
+
+  uint8_t index = _numSensors++;
+  _channels[index] = channel;
+  _failed[index] = false;
+
+  // Insert the new sensor into the sweep order, keeping it sorted by channel
+  uint8_t position = index;
+  while ((position > 0) && (_channels[_order[position - 1]] > channel))
+  {
+    _order[position] = _order[position - 1];
+    position--;
+  }
+  _order[position] = index;
+
+  return (index);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Begin all of the sensors, and enable their configuration caches
+    @param  wirePort
+            <br>The TwoWire (I2C) port the muxes are connected to.
+            <br>Default is Wire.
+    @return True if communication with all of the sensors was successful, otherwise false.
+*/
+/**************************************************************************/
+bool VEML7700ArrayBase::begin(TwoWire &wirePort)
+{
+  return (beginSensors(&wirePort, NULL));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Begin all of the sensors using a custom transport, and enable their configuration caches
+    @param  transport
+            <br>The VEML7700Transport shared by all of the sensors. The mux select callback is still
+            <br>used to select each sensor's channel.
+    @return True if communication with all of the sensors was successful, otherwise false.
+*/
+/**************************************************************************/
+bool VEML7700ArrayBase::begin(VEML7700Transport &transport)
+{
+  return (beginSensors(NULL, &transport));
+}
+
+bool VEML7700ArrayBase::beginSensors(TwoWire *wirePort, VEML7700Transport *transport)
+{
+  bool success = true;
+
+  _wirePort = wirePort;
+  _transport = transport;
+  _selectedChannel = -1; // We don't know what the muxes are doing
+  _sweepStarted = false;
+
+  for (uint8_t i = 0; i < _numSensors; i++)
+  {
+    if (!beginSensor(sweepIndex(i)))
+      success = false;
+  }
+
+  _reverse = !_reverse;
+
+  return (success);
+}
+
+bool VEML7700ArrayBase::beginSensor(uint8_t index)
+{
+  _failed[index] = !selectChannel(_channels[index])
+                   || !((_transport != NULL) ? _sensors[index].begin(*_transport) : _sensors[index].begin(*_wirePort));
+
+  if (!_failed[index])
+    _sensors[index].enableConfigurationCache();
+
+  return (!_failed[index]);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Begin the failed sensors again, e.g. after a mux or sensor has been reconnected
+            <br>Call begin first. A recovered sensor joins the next startSweep.
+    @return The number of sensors recovered
+*/
+/**************************************************************************/
+uint8_t VEML7700ArrayBase::reprobe()
+{
+  uint8_t recovered = 0;
+
+  if ((_wirePort == NULL) && (_transport == NULL))
+    return (0); // begin has not been called
+
+  for (uint8_t i = 0; i < _numSensors; i++)
+  {
+    uint8_t index = sweepIndex(i);
+
+    if (_failed[index] && beginSensor(index))
+      recovered++;
+  }
+
+  _reverse = !_reverse;
+
+  return (recovered);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Select the mux channel for one sensor, so it can be accessed directly
+    @param  index
+            <br>The sensor index returned by addSensor
+    @return True if the channel was selected successfully
+*/
+/**************************************************************************/
+bool VEML7700ArrayBase::select(uint8_t index)
+{
+  if (index >= _numSensors)
+    return (false);
+
+  return (selectChannel(_channels[index]));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Apply the same configuration to all of the sensors, with a single write to each
+            <br>Failed sensors (see isFailed) are skipped
+    @param  config
+            <br>The complete configuration
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful for all sensors,
+            <br>otherwise the last error
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700ArrayBase::applyConfiguration(const VEML7700_config_t &config)
+{
+  VEML7700_error_t result = VEML7700_ERROR_SUCCESS;
+
+  for (uint8_t i = 0; i < _numSensors; i++)
+  {
+    uint8_t index = sweepIndex(i);
+    VEML7700_error_t err = VEML7700_ERROR_UNDEFINED;
+
+    if (_failed[index])
+      continue;
+
+    if (selectChannel(_channels[index]))
+      err = _sensors[index].applyConfiguration(config);
+
+    if (err != VEML7700_ERROR_SUCCESS)
+      result = err;
+  }
+
+  _reverse = !_reverse;
+
+  return (result);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Start the integrations on all of the sensors, as close together as possible
+            <br>Failed sensors (see isFailed) are skipped. A sensor which fails to start is marked as failed.
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful for all of the (working) sensors,
+            <br>otherwise the last error
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700ArrayBase::startSweep()
+{
+  VEML7700_error_t result = VEML7700_ERROR_SUCCESS;
+
+  for (uint8_t i = 0; i < _numSensors; i++)
+  {
+    uint8_t index = sweepIndex(i);
+    VEML7700_error_t err = VEML7700_ERROR_UNDEFINED;
+
+    if (_failed[index])
+      continue;
+
+    if (selectChannel(_channels[index]))
+      err = _sensors[index].startMeasurement();
+
+    if (err != VEML7700_ERROR_SUCCESS)
+    {
+      _failed[index] = true;
+      result = err;
+    }
+  }
+
+  _reverse = !_reverse;
+  _sweepStarted = true;
+
+  return (result);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Check if all of the sensors have a fresh conversion. Does not use I2C.
+            <br>Failed sensors (see isFailed) are not waited for.
+    @return True if every (working) sensor is ready
+*/
+/**************************************************************************/
+bool VEML7700ArrayBase::isSweepReady()
+{
+  for (uint8_t i = 0; i < _numSensors; i++)
+  {
+    if (!_failed[i] && !_sensors[i].isMeasurementReady())
+      return (false);
+  }
+  return (true);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Read every sensor which has a fresh conversion, selecting each channel once
+    @param  lux
+            <br>An array of (at least) getNumSensors floats. Set to the lux of each sensor
+            <br>(in index order) if a fresh conversion was read. Other entries are unchanged.
+    @param  errors
+            <br>Optional. An array of getNumSensors VEML7700_error_t. Set to the result for each sensor.
+    @return The number of fresh readings
+*/
+/**************************************************************************/
+uint8_t VEML7700ArrayBase::readSweep(float *lux, VEML7700_error_t *errors)
+{
+  return (readSweep(lux, NULL, errors));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Read every sensor which has a fresh conversion, in millilux, selecting each channel once
+    @param  milliLux
+            <br>An array of (at least) getNumSensors uint32_t. Set to the lux * 1000 of each sensor
+            <br>(in index order) if a fresh conversion was read. Other entries are unchanged.
+    @param  errors
+            <br>Optional. An array of getNumSensors VEML7700_error_t. Set to the result for each sensor.
+    @return The number of fresh readings
+*/
+/**************************************************************************/
+uint8_t VEML7700ArrayBase::readSweep(uint32_t *milliLux, VEML7700_error_t *errors)
+{
+  return (readSweep(NULL, milliLux, errors));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Wait until all of the sensors are ready, then read them. This is blocking.
+            <br>Starts the sweep first if needed. Failed sensors (see isFailed) are not waited for,
+            <br>and the wait is limited to the slowest sensor's conversion plus a margin.
+    @param  lux
+            <br>An array of (at least) getNumSensors floats. Set to the lux of each sensor (in index order)
+    @param  errors
+            <br>Optional. An array of getNumSensors VEML7700_error_t. Set to the result for each sensor.
+    @return The number of fresh readings
+*/
+/**************************************************************************/
+uint8_t VEML7700ArrayBase::sweep(float *lux, VEML7700_error_t *errors)
+{
+  if (!_sweepStarted)
+    startSweep();
+
+  // Don't wait forever: the last conversion to complete, plus a margin
+  unsigned long deadline = millis();
+  for (uint8_t i = 0; i < _numSensors; i++)
+  {
+    if (!_failed[i] && ((long)(_sensors[i].getMeasurementReadyMillis() - deadline) > 0))
+      deadline = _sensors[i].getMeasurementReadyMillis();
+  }
+  deadline += VEML7700_ARRAY_SWEEP_MARGIN_ms;
+
+  while (!isSweepReady() && ((long)(millis() - deadline) < 0))
+    delay(1);
+
+  return (readSweep(lux, NULL, errors));
+}
+
+bool VEML7700ArrayBase::selectChannel(uint8_t channel)
+{
+  if (_selectedChannel == (int16_t)channel)
+    return (true);
+
+  if ((_muxSelect != NULL) && !_muxSelect(channel, _muxContext))
+  {
+    _selectedChannel = -1;
+    return (false);
+  }
+
+  _selectedChannel = channel;
+  return (true);
+}
+
+uint8_t VEML7700ArrayBase::sweepIndex(uint8_t position)
+{
+  if (_reverse)
+    return (_order[_numSensors - 1 - position]);
+  return (_order[position]);
+}
+
+uint8_t VEML7700ArrayBase::readSweep(float *lux, uint32_t *milliLux, VEML7700_error_t *errors)
+{
+  uint8_t fresh = 0;
+
+  for (uint8_t i = 0; i < _numSensors; i++)
+  {
+    uint8_t index = sweepIndex(i);
+    VEML7700_error_t err = VEML7700_ERROR_NOT_READY;
+
+    // Only select the channel if the sensor is working and has a fresh conversion. This check does not use I2C.
+    if (_failed[index])
+      err = VEML7700_ERROR_UNDEFINED;
+    else if (_sensors[index].isMeasurementReady())
+    {
+      if (!selectChannel(_channels[index]))
+        err = VEML7700_ERROR_UNDEFINED;
+      else if (lux != NULL)
+        err = _sensors[index].poll(&lux[index]);
+      else
+        err = _sensors[index].poll(&milliLux[index]);
+    }
+
+    if (err == VEML7700_ERROR_SUCCESS)
+      fresh++;
+
+    if (errors != NULL)
+      errors[index] = err;
+  }
+
+  _reverse = !_reverse;
+
+  return (fresh);
+}
+
+VEML7700SampleBufferBase::VEML7700SampleBufferBase(VEML7700_sample_t *samples, uint16_t capacity)
+{
+  // Note: the storage has not been constructed yet. Only store the pointer here.
+  _samples = samples;
+  _capacity = capacity;
+  _head = 0;
+  _count = 0;
+  _gaps = 0;
+  _overwrites = 0;
+  _oldestMillis = 0;
+  _newestMillis = 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Store a sample, timestamped with millis()
+            <br>If the buffer is full, the oldest sample is overwritten
+    @param  ambient
+            <br>The ALS count
+    @param  sm
+            <br>The sensitivity mode (gain) used for the conversion
+    @param  it
+            <br>The integration time used for the conversion
+*/
+/**************************************************************************/
+void VEML7700SampleBufferBase::push(uint16_t ambient, VEML7700_sensitivity_mode_t sm, VEML7700_integration_time_t it)
+{
+  push(ambient, sm, it, millis());
+}
+
+/**************************************************************************/
+/*!
+    @brief  Store a sample with a chosen timestamp
+            <br>If the buffer is full, the oldest sample is overwritten
+    @param  ambient
+            <br>The ALS count
+    @param  sm
+            <br>The sensitivity mode (gain) used for the conversion
+    @param  it
+            <br>The integration time used for the conversion
+    @param  now
+            <br>The millis() timestamp. Must not be earlier than the previous sample
+*/
+/**************************************************************************/
+void VEML7700SampleBufferBase::push(uint16_t ambient, VEML7700_sensitivity_mode_t sm, VEML7700_integration_time_t it, unsigned long now)
+{
+  if ((_capacity == 0) || (sm >= VEML7700_SENSITIVITY_INVALID) || (it >= VEML7700_INTEGRATION_INVALID))
+    return;
+
+  unsigned long ticks = 0;
+
+  if (_count > 0)
+  {
+    /** Round to the nearest tick. _newestMillis follows the recorded (rounded) ticks,
+        so the rounding errors do not accumulate. */
+    ticks = ((now - _newestMillis) + (VEML7700_SAMPLE_TICK_ms / 2)) / VEML7700_SAMPLE_TICK_ms;
+    if (ticks > VEML7700_SAMPLE_MAX_GAP_TICKS)
+      ticks = VEML7700_SAMPLE_MAX_GAP_TICKS;
+  }
+  _newestMillis = (_count > 0) ? _newestMillis + (ticks * VEML7700_SAMPLE_TICK_ms) : now;
+
+  // Make room: one slot, or two if the gap needs a gap record
+  uint16_t slots = (ticks > 0xFF) ? 2 : 1;
+  while ((_count > 0) && ((_count + slots) > _capacity))
+  {
+    pop(NULL); // Overwrite the oldest sample
+    _overwrites++;
+  }
+
+  if (_count == 0)
+  {
+    // Empty (or everything was overwritten): this sample is the oldest
+    _oldestMillis = _newestMillis;
+    ticks = 0;
+  }
+
+  if (ticks > 0xFF)
+  {
+    // The gap record holds the whole gap: ambient is the 256 tick units, delta the remainder
+    append((uint16_t)(ticks >> 8), VEML7700_SAMPLE_GAP, (uint8_t)(ticks & 0xFF));
+    _gaps++;
+    ticks = 0;
+  }
+
+  append(ambient, (uint8_t)((sm * VEML7700_INTEGRATION_INVALID) + it), (uint8_t)ticks);
+}
+
+void VEML7700SampleBufferBase::append(uint16_t ambient, uint8_t range, uint8_t delta)
+{
+  VEML7700_sample_t *sample = &_samples[(_head + _count) % _capacity];
+  sample->ambient = ambient;
+  sample->range = range;
+  sample->delta = delta;
+  _count++;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Remove all of the samples
+*/
+/**************************************************************************/
+void VEML7700SampleBufferBase::clear()
+{
+  _head = 0;
+  _count = 0;
+  _gaps = 0;
+}
+
+void VEML7700SampleBufferBase::pop(unsigned long *timestamp)
+{
+  if (timestamp != NULL)
+    *timestamp = _oldestMillis;
+
+  _head = (_head + 1) % _capacity;
+  _count--;
+
+  // The next sample's delta is relative to the one we have just removed. Step over any gap record
+  while (_count > 0)
+  {
+    const VEML7700_sample_t *next = &_samples[_head];
+    _oldestMillis += (unsigned long)next->delta * VEML7700_SAMPLE_TICK_ms;
+
+    if (next->range != VEML7700_SAMPLE_GAP)
+      break;
+
+    _oldestMillis += ((unsigned long)next->ambient << 8) * VEML7700_SAMPLE_TICK_ms;
+    _head = (_head + 1) % _capacity;
+    _count--;
+    _gaps--;
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Remove a batch of samples and convert them to lux
+    @param  lux
+            <br>Will be filled with up to maxCount lux values, oldest first
+    @param  maxCount
+            <br>The size of lux (and timestamps)
+    @param  timestamps
+            <br>Optional. Will be filled with the millis() each sample was stored
+    @return The number of samples removed
+*/
+/**************************************************************************/
+uint16_t VEML7700SampleBufferBase::drain(float *lux, uint16_t maxCount, unsigned long *timestamps)
+{
+  const float *resolution = &VEML7700_LUX_RESOLUTION[0][0]; // Indexed by VEML7700_sample_t.range
+  uint16_t n = 0;
+
+  for (; (n < maxCount) && (_count > 0); n++)
+  {
+    const VEML7700_sample_t *sample = &_samples[_head];
+    lux[n] = (float)sample->ambient * pgm_read_float(&resolution[sample->range]);
+    pop((timestamps == NULL) ? NULL : &timestamps[n]);
+  }
+
+  return (n);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Remove a batch of samples and convert them to millilux, using integer math only
+    @param  milliLux
+            <br>Will be filled with up to maxCount lux * 1000 values, oldest first
+    @param  maxCount
+            <br>The size of milliLux (and timestamps)
+    @param  timestamps
+            <br>Optional. Will be filled with the millis() each sample was stored
+    @return The number of samples removed
+*/
+/**************************************************************************/
+uint16_t VEML7700SampleBufferBase::drain(uint32_t *milliLux, uint16_t maxCount, unsigned long *timestamps)
+{
+  const uint16_t *resolution = &VEML7700_LUX_RESOLUTION_x10000[0][0]; // Indexed by VEML7700_sample_t.range
+  uint16_t n = 0;
+
+  for (; (n < maxCount) && (_count > 0); n++)
+  {
+    const VEML7700_sample_t *sample = &_samples[_head];
+    milliLux[n] = (((uint32_t)sample->ambient * pgm_read_word(&resolution[sample->range])) + 5) / 10;
+    pop((timestamps == NULL) ? NULL : &timestamps[n]);
+  }
+
+  return (n);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Remove a batch of raw samples
+    @param  samples
+            <br>Will be filled with up to maxCount samples, oldest first
+    @param  maxCount
+            <br>The size of samples (and timestamps)
+    @param  timestamps
+            <br>Optional. Will be filled with the millis() each sample was stored
+    @return The number of samples removed
+*/
+/**************************************************************************/
+uint16_t VEML7700SampleBufferBase::drain(VEML7700_sample_t *samples, uint16_t maxCount, unsigned long *timestamps)
+{
+  uint16_t n = 0;
+
+  for (; (n < maxCount) && (_count > 0); n++)
+  {
+    samples[n] = _samples[_head];
+    pop((timestamps == NULL) ? NULL : &timestamps[n]);
+  }
+
+  return (n);
+}
+
+VEML7700Statistics::VEML7700Statistics()
+{
+  reset();
+  _emaShift = 3;
+  _emaStarted = false;
+  _emaSum = 0;
+  _decimation = 1;
+  _blockCount = 0;
+  _blockSum = 0;
+  _decimated = 0;
+  _decimatedReady = false;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Add a sample
+            <br>The count is normalized to the finest resolution, using the gain and integration time
+    @param  ambient
+            <br>The ALS count
+    @param  sm
+            <br>The sensitivity mode (gain) used for the conversion
+    @param  it
+            <br>The integration time used for the conversion
+*/
+/**************************************************************************/
+void VEML7700Statistics::add(uint16_t ambient, VEML7700_sensitivity_mode_t sm, VEML7700_integration_time_t it)
+{
+  if ((sm >= VEML7700_SENSITIVITY_INVALID) || (it >= VEML7700_INTEGRATION_INVALID))
+    return;
+
+  // The resolutions are all power-of-two multiples of the base, so this is exact. At most 65535 << 9
+  uint32_t x = (uint32_t)ambient * (pgm_read_word(&VEML7700_LUX_RESOLUTION_x10000[sm][it]) / VEML7700_BASE_RESOLUTION_x10000);
+
+  /** Welford, in integer math. In float, delta / count drops below half an ulp of the mean
+      after a long stream and the mean and variance stop tracking.
+      The mean is the exact sum / count. x and the sum are below 2^25 and 2^57. */
+  if ((_count > 0) && (_count < 0xFFFFFFFF))
+  {
+    // delta = x - (the mean so far), in Q4. |delta| < 2^29, so delta^2 fits
+    int64_t scaled = (((int64_t)x * (int64_t)_count) - (int64_t)_sum) * 16;
+    int64_t delta = ((scaled >= 0) ? (scaled + (_count / 2)) : (scaled - (_count / 2))) / (int64_t)_count; // Rounded
+
+    // delta * (x - the new mean) = delta^2 * count / (count + 1). delta^2 is Q8: shift to Q4
+    uint64_t term = ((uint64_t)(delta * delta) + 8) >> 4;
+    term -= term / (_count + 1);
+    term >>= _m2Shift;
+
+    // Keep the top bits rather than overflowing
+    while (term > (0xFFFFFFFFFFFFFFFFULL - _m2))
+    {
+      _m2 >>= 1;
+      term >>= 1;
+      _m2Shift++;
+    }
+    _m2 += term;
+  }
+
+  if (_count < 0xFFFFFFFF)
+  {
+    _count++;
+    _sum += x;
+  }
+
+  if (x < _min)
+    _min = x;
+  if (x > _max)
+    _max = x;
+
+  // EMA. Start from the first sample, not from zero
+  if (_emaStarted)
+    _emaSum = _emaSum - (_emaSum >> _emaShift) + x;
+  else
+  {
+    _emaSum = x << _emaShift;
+    _emaStarted = true;
+  }
+
+  // Boxcar decimator
+  _blockSum += x;
+  if (++_blockCount >= _decimation)
+  {
+    _decimated = (_blockSum + (_decimation / 2)) / _decimation;
+    _decimatedReady = true;
+    _blockSum = 0;
+    _blockCount = 0;
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reset the mean, variance, min and max
+            <br>The EMA and the decimator are not affected
+*/
+/**************************************************************************/
+void VEML7700Statistics::reset()
+{
+  _count = 0;
+  _sum = 0;
+  _m2 = 0;
+  _m2Shift = 0;
+  _min = 0xFFFFFFFF;
+  _max = 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the mean of the samples since the last reset
+    @return The mean lux. 0.0 if there are no samples
+*/
+/**************************************************************************/
+float VEML7700Statistics::getMeanLux()
+{
+  if (_count == 0)
+    return (0.0);
+
+  return (((float)_sum / (float)_count) * (float)VEML7700_BASE_RESOLUTION);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the sample variance of the samples since the last reset
+    @return The variance in lux^2. 0.0 if there are fewer than two samples
+*/
+/**************************************************************************/
+float VEML7700Statistics::getVarianceLux()
+{
+  if (_count < 2)
+    return (0.0);
+
+  float m2 = ldexp((float)_m2, (int)_m2Shift - 4); // Q4 to normalized counts^2
+
+  return ((m2 / (float)(_count - 1)) * (float)(VEML7700_BASE_RESOLUTION * VEML7700_BASE_RESOLUTION));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the standard deviation of the samples since the last reset
+    @return The standard deviation in lux. 0.0 if there are fewer than two samples
+*/
+/**************************************************************************/
+float VEML7700Statistics::getStdDevLux()
+{
+  return (sqrt(getVarianceLux()));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the smallest sample since the last reset
+    @return The minimum lux. 0.0 if there are no samples
+*/
+/**************************************************************************/
+float VEML7700Statistics::getMinLux()
+{
+  if (_count == 0)
+    return (0.0);
+
+  return ((float)_min * (float)VEML7700_BASE_RESOLUTION);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the largest sample since the last reset
+    @return The maximum lux. 0.0 if there are no samples
+*/
+/**************************************************************************/
+float VEML7700Statistics::getMaxLux()
+{
+  return ((float)_max * (float)VEML7700_BASE_RESOLUTION);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set the EMA smoothing
+            <br>Each sample moves the average 1/(2^shift) of the way towards it.
+            <br>The time constant is approximately 2^shift samples. The default is 3 (8 samples).
+            <br>The EMA restarts from the next sample.
+    @param  shift
+            <br>0 (no smoothing) to 6 (64 samples)
+*/
+/**************************************************************************/
+void VEML7700Statistics::setEMAShift(uint8_t shift)
+{
+  _emaShift = (shift > VEML7700_MAX_EMA_SHIFT) ? VEML7700_MAX_EMA_SHIFT : shift;
+  _emaStarted = false;
+  _emaSum = 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the exponential moving average
+    @return The EMA in lux. 0.0 if there are no samples
+*/
+/**************************************************************************/
+float VEML7700Statistics::getEMALux()
+{
+  return ((float)_emaSum * (float)VEML7700_BASE_RESOLUTION / (float)(1UL << _emaShift));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set the boxcar decimation factor
+            <br>Each block of factor samples is averaged into one decimated sample.
+            <br>The current block is discarded.
+    @param  factor
+            <br>1 (no decimation) to 128
+*/
+/**************************************************************************/
+void VEML7700Statistics::setDecimation(uint8_t factor)
+{
+  if (factor == 0)
+    factor = 1;
+  _decimation = (factor > VEML7700_MAX_DECIMATION) ? VEML7700_MAX_DECIMATION : factor;
+  _blockCount = 0;
+  _blockSum = 0;
+  _decimatedReady = false;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the latest decimated sample
+    @param  lux
+            <br>Will be set to the mean lux of the last complete block, if there is a new one
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if a new block has completed
+            <br>VEML7700_ERROR_NOT_READY if not
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700Statistics::getDecimatedLux(float *lux)
+{
+  if (!_decimatedReady)
+    return (VEML7700_ERROR_NOT_READY);
+
+  *lux = (float)_decimated * (float)VEML7700_BASE_RESOLUTION;
+  _decimatedReady = false;
+
+  return (VEML7700_ERROR_SUCCESS);
+}
+
+/** The flicker analysis frequencies, in VEML7700_flicker_frequency_t order. Stored in flash (PROGMEM) */
+const uint8_t VEML7700_FLICKER_FREQUENCIES_Hz[VEML7700_FLICKER_INVALID] PROGMEM =
+{
+  50, 60, 100, 120
+};
+
+VEML7700Flicker::VEML7700Flicker()
+{
+  _mean = 0.0;
+  _observable = 0;
+  for (uint8_t f = 0; f < VEML7700_FLICKER_INVALID; f++)
+  {
+    _depth[f] = 0.0;
+    _alias[f] = 0.0;
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Analyse a series of evenly spaced ALS counts for flicker
+            <br>A Hann-windowed Goertzel filter is run for each of the mains (and double mains)
+            <br>frequencies, at the frequency each one aliases to in the sampled series.
+            <br>The amplitude is corrected for the averaging of the integration time.
+            <br>A frequency is not observable if: it aliases to within two bins of DC or one
+            <br>bin of the Nyquist frequency; the integration time averages it away (e.g.
+            <br>120Hz with 25ms); or two frequencies alias to within two bins of each other.
+    @param  ambient
+            <br>The samples: raw ALS counts, all with the same gain and integration time
+    @param  count
+            <br>The number of samples
+    @param  sampleMicros
+            <br>The time between samples in microseconds
+    @param  integrationMicros
+            <br>The integration time in microseconds
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+            <br>VEML7700_ERROR_UNDERRANGE if it was too dark to analyse (the mean is below one count)
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700Flicker::analyze(const uint16_t *ambient, uint16_t count, unsigned long sampleMicros, unsigned long integrationMicros)
+{
+  _observable = 0;
+  _mean = 0.0;
+
+  if ((ambient == NULL) || (count < 2) || (sampleMicros == 0))
+    return (VEML7700_ERROR_UNDEFINED);
+
+  uint32_t sum = 0;
+  for (uint16_t i = 0; i < count; i++)
+    sum += ambient[i];
+  _mean = (float)sum / (float)count;
+
+  if (_mean < 1.0)
+    return (VEML7700_ERROR_UNDERRANGE);
+
+  float sampleRate = 1000000.0 / (float)sampleMicros;
+  float bin = sampleRate / (float)count; // The frequency resolution
+  float coefficient[VEML7700_FLICKER_INVALID];
+  float response[VEML7700_FLICKER_INVALID];
+  float s1[VEML7700_FLICKER_INVALID];
+  float s2[VEML7700_FLICKER_INVALID];
+
+  for (uint8_t f = 0; f < VEML7700_FLICKER_INVALID; f++)
+  {
+    float frequency = (float)pgm_read_byte(&VEML7700_FLICKER_FREQUENCIES_Hz[f]);
+
+    // Fold the frequency into 0 to sampleRate / 2
+    _alias[f] = fmod(frequency, sampleRate);
+    if (_alias[f] > (sampleRate / 2.0))
+      _alias[f] = sampleRate - _alias[f];
+
+    // Each sample is the mean over the integration time: a sinc response
+    float x = PI * frequency * (float)integrationMicros / 1000000.0;
+    response[f] = fabs(sin(x) / x);
+
+    if ((_alias[f] >= (2.0 * bin)) && (_alias[f] <= ((sampleRate / 2.0) - bin)) && (response[f] >= VEML7700_FLICKER_MIN_RESPONSE))
+      _observable |= (uint8_t)(1 << f);
+
+    coefficient[f] = 2.0 * cos(2.0 * PI * _alias[f] / sampleRate);
+    s1[f] = 0.0;
+    s2[f] = 0.0;
+  }
+
+  // Frequencies which alias on top of each other cannot be told apart
+  for (uint8_t f = 0; f < VEML7700_FLICKER_INVALID; f++)
+    for (uint8_t g = f + 1; g < VEML7700_FLICKER_INVALID; g++)
+      if ((_observable & (1 << f)) && (_observable & (1 << g)) && (fabs(_alias[f] - _alias[g]) < (2.0 * bin)))
+        _observable &= (uint8_t)~((1 << f) | (1 << g));
+
+  // Run the filters. The Hann window reduces the leakage between frequencies
+  for (uint16_t i = 0; i < count; i++)
+  {
+    float x = ((float)ambient[i] - _mean) * (0.5 - (0.5 * cos(2.0 * PI * (float)i / (float)(count - 1))));
+
+    for (uint8_t f = 0; f < VEML7700_FLICKER_INVALID; f++)
+    {
+      float s0 = x + (coefficient[f] * s1[f]) - s2[f];
+      s2[f] = s1[f];
+      s1[f] = s0;
+    }
+  }
+
+  for (uint8_t f = 0; f < VEML7700_FLICKER_INVALID; f++)
+  {
+    float power = (s1[f] * s1[f]) + (s2[f] * s2[f]) - (coefficient[f] * s1[f] * s2[f]);
+    if (power < 0.0)
+      power = 0.0; // Rounding
+
+    // The Hann window has a coherent gain of 1/2, so the sinusoid amplitude is 4|X|/N
+    float amplitude = 4.0 * sqrt(power) / (float)count;
+    _depth[f] = amplitude / (response[f] * _mean);
+  }
+
+  return (VEML7700_ERROR_SUCCESS);
+}
+
+/**************************************************************************/
 /*!
-    @brief  Get the VEML7700's ambient light sensor data (ALS)
-    @return The ambient light reading
+    @brief  Check if a frequency could be seen in the last analysis
+    @param  frequency
+            <br>The frequency
+    @return True if the frequency was observable
 */
 /**************************************************************************/
-uint16_t VEML7700::getAmbientLight()
+bool VEML7700Flicker::isObservable(VEML7700_flicker_frequency_t frequency)
 {
-  uint16_t ambient;
-  getAmbientLight(&ambient);
-  return (ambient);
+  if (frequency >= VEML7700_FLICKER_INVALID)
+    return (false);
+  return ((_observable & (1 << frequency)) != 0);
 }
 
 /**************************************************************************/
 /*!
-    @brief  Get the VEML7700's white level data (WHITE)
-    @param  whiteLevel
-            <br>Will be set to the white level on return
+    @brief  Get the flicker modulation depth at a frequency
+            <br>This is the amplitude of the flicker divided by the mean light level:
+            <br>0.0 is steady light, 1.0 is fully modulated. For a sinusoid this equals
+            <br>the percent flicker / 100.
+    @param  frequency
+            <br>The frequency
+    @param  depth
+            <br>Will be set to the modulation depth on return
     @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+            <br>VEML7700_ERROR_UNDEFINED if the frequency was not observable
 */
 /**************************************************************************/
-VEML7700_error_t VEML7700::getWhiteLevel(uint16_t *whiteLevel)
+VEML7700_error_t VEML7700Flicker::getDepth(VEML7700_flicker_frequency_t frequency, float *depth)
 {
-  return (readI2CRegister((VEML7700_t *)whiteLevel, VEML7700_WHITE_OUTPUT));
+  if (!isObservable(frequency))
+    return (VEML7700_ERROR_UNDEFINED);
+
+  *depth = _depth[frequency];
+  return (VEML7700_ERROR_SUCCESS);
 }
 
 /**************************************************************************/
 /*!
-    @brief  Get the VEML7700's white level data (WHITE)
-    @return The white level reading
+    @brief  Get the flicker modulation depth at a frequency
+    @param  frequency
+            <br>The frequency
+    @return The modulation depth. 0.0 if the frequency was not observable
 */
 /**************************************************************************/
-uint16_t VEML7700::getWhiteLevel()
+float VEML7700Flicker::getDepth(VEML7700_flicker_frequency_t frequency)
 {
-  uint16_t whiteLevel;
-  getWhiteLevel(&whiteLevel);
-  return (whiteLevel);
+  float depth = 0.0;
+  getDepth(frequency, &depth);
+  return (depth);
 }
 
 /**************************************************************************/
 /*!
-    @brief  Read the sensor data and calculate the lux
-    @param  lux
-            <br>Will be set to the lux on return
-    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+    @brief  Get the frequency a flicker frequency appears at in the sampled series
+    @param  frequency
+            <br>The frequency
+    @return The alias frequency in Hz, from the last analysis
 */
 /**************************************************************************/
-VEML7700_error_t VEML7700::getLux(float *lux)
+float VEML7700Flicker::getAliasFrequency(VEML7700_flicker_frequency_t frequency)
 {
-  /** First, we need to extract the correct resolution from the VEML7700_LUX_RESOLUTION
-      gain and integration time look up table. Let's begin by reading the gain
-      (sensitivity) and integration time. */
+  if (frequency >= VEML7700_FLICKER_INVALID)
+    return (0.0);
+  return (_alias[frequency]);
+}
 
+VEML7700AdaptiveScheduler::VEML7700AdaptiveScheduler()
+{
+  _sensor = NULL;
+  _statistics = NULL;
+  _stableChange = 0.05;
+  _fastChange = 0.25;
+  _stableSamples = 4;
+  _stableCount = 0;
+  _fastIntegration = VEML7700_INTEGRATION_25ms;
+  _normalIntegration = VEML7700_INTEGRATION_100ms;
+  _maxInterval = VEML7700_SCHEDULER_MAX_SLEEP_ms;
+  _level = 0;
+  _started = false;
+  _sleeping = false;
+  _wakeMillis = 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Start the adaptive sampling
+            <br>Attaches the statistics stage to the sensor, starts at the fast level
+            <br>and starts the measurements. Call sensor.begin first.
+    @param  sensor
+            <br>The VEML7700. The scheduler calls its poll: do not call poll elsewhere
+    @param  statistics
+            <br>The statistics stage. Its EMA is the reference each sample is compared with
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700AdaptiveScheduler::begin(VEML7700 &sensor, VEML7700Statistics &statistics)
+{
   VEML7700_error_t err;
-  VEML7700_sensitivity_mode_t sm;
 
-  err = getSensitivityMode(&sm);
+  _sensor = &sensor;
+  _statistics = &statistics;
+  _sensor->setStatistics(_statistics);
+
+  _stableCount = 0;
+  _started = false;
+  _sleeping = false;
 
+  err = applyLevel(0, true);
   if (err != VEML7700_ERROR_SUCCESS)
     return (err);
 
-  if (_debugEnabled)
+  return (_sensor->startMeasurement());
+}
+
+/**************************************************************************/
+/*!
+    @brief  Take a sample if one is due, and adapt the sampling to it
+            <br>When the sensor is shut down and the wake time has arrived, this powers it on
+            <br>and returns VEML7700_ERROR_NOT_READY. The sample is collected by a later call.
+    @param  lux
+            <br>Will be set to the lux on return, if a sample was taken
+    @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if a sample was taken
+            <br>VEML7700_ERROR_NOT_READY if no sample was due
+*/
+/**************************************************************************/
+VEML7700_error_t VEML7700AdaptiveScheduler::service(float *lux)
+{
+  VEML7700_error_t err;
+
+  if (_sensor == NULL)
+    return (VEML7700_ERROR_UNDEFINED);
+
+  if (_sleeping)
   {
-    _debugPort->print(F("VEML7700::getLux: gain / sensitivity: "));
-    _debugPort->println(VEML7700_GAIN_SETTINGS[sm]);
-  }
+    if ((long)(millis() - _wakeMillis) < 0)
+      return (VEML7700_ERROR_NOT_READY);
 
-  VEML7700_integration_time_t it;
+    err = _sensor->startMeasurement(); // Power on. The conversion is ready at getMeasurementReadyMillis
+    if (err != VEML7700_ERROR_SUCCESS)
+      return (err);
 
-  err = getIntegrationTime(&it);
+    _sleeping = false;
+    return (VEML7700_ERROR_NOT_READY);
+  }
 
+  // Before poll adds this sample. The EMA is in datasheet lux, poll returns the calibrated lux
+  float reference = _sensor->applyCalibration(_statistics->getEMALux());
+
+  err = _sensor->poll(lux);
   if (err != VEML7700_ERROR_SUCCESS)
     return (err);
 
-  if (_debugEnabled)
+  uint8_t level = _level;
+
+  if (_started)
   {
-    _debugPort->print(F("VEML7700::getLux: integration time: "));
-    _debugPort->println(VEML7700_INTEGRATION_TIMES[it]);
+    float change = fabs(*lux - reference) / ((reference > VEML7700_SCHEDULER_FLOOR_LUX) ? reference : VEML7700_SCHEDULER_FLOOR_LUX);
+
+    if (change >= _fastChange)
+    {
+      level = 0;
+      _stableCount = 0;
+    }
+    else if (change < _stableChange)
+    {
+      if (++_stableCount >= _stableSamples)
+      {
+        _stableCount = 0;
+        if ((level < VEML7700_SCHEDULER_SLEEP_LEVEL) || (sleepIntervalMillis(level) < _maxInterval))
+          level++;
+      }
+    }
+    else
+      _stableCount = 0;
   }
+  _started = true;
 
-  /** Now we can extract the correct resolution from the look up table. */
-  float resolution = VEML7700_LUX_RESOLUTION[sm][it];
+  bool wasSleepLevel = (_level >= VEML7700_SCHEDULER_SLEEP_LEVEL);
 
-  if (_debugEnabled)
+  if (level != _level)
   {
-    _debugPort->print(F("VEML7700::getLux: resolution: "));
-    _debugPort->println(resolution, 4);
+    err = applyLevel(level, false);
+    if (err != VEML7700_ERROR_SUCCESS)
+      return (err);
   }
 
-  /** Now we read the ambient level and multiply it by the resolution */
-  uint16_t ambient;
+  if (_level >= VEML7700_SCHEDULER_SLEEP_LEVEL)
+  {
+    unsigned long interval = sleepIntervalMillis(_level);
 
-  err = getAmbientLight(&ambient);
+    // Keep to the schedule: the interval is from the previous wake. Restart it if we are late
+    if (!wasSleepLevel)
+      _wakeMillis = millis();
+    _wakeMillis += interval;
+    if ((long)(millis() - _wakeMillis) >= 0)
+      _wakeMillis = millis() + interval;
 
-  if (err != VEML7700_ERROR_SUCCESS)
-    return (err);
+    err = _sensor->shutdown();
+    if (err != VEML7700_ERROR_SUCCESS)
+      return (err);
 
-  if (_debugEnabled)
-  {
-    _debugPort->print(F("VEML7700::getLux: ambient: "));
-    _debugPort->println(ambient);
+    _sleeping = true;
   }
 
-  *lux = (float)ambient * resolution;
+  return (VEML7700_ERROR_SUCCESS);
+}
 
-  if (_debugEnabled)
-  {
-    _debugPort->print(F("VEML7700::getLux: lux: "));
-    _debugPort->println(*lux, 4);
-  }
+/**************************************************************************/
+/*!
+    @brief  Get the time at which service next needs to be called
+            <br>This is the wake time when the sensor is shut down, otherwise the time
+            <br>the next conversion is ready
+    @return The millis() to sleep until
+*/
+/**************************************************************************/
+unsigned long VEML7700AdaptiveScheduler::nextWakeMillis()
+{
+  if (_sensor == NULL)
+    return (millis());
 
-  return (VEML7700_ERROR_SUCCESS);
+  if (_sleeping)
+    return (_wakeMillis);
+
+  return (_sensor->getMeasurementReadyMillis());
 }
 
 /**************************************************************************/
 /*!
-    @brief  Read the sensor data and calculate the lux
-    @return The lux
+    @brief  Get the time until service next needs to be called
+    @return The milliseconds to sleep for. 0 if service should be called now
 */
 /**************************************************************************/
-float VEML7700::getLux()
+unsigned long VEML7700AdaptiveScheduler::millisUntilWake()
 {
-  float lux = 0.0;
-  getLux(&lux);
-  return (lux);
+  long remaining = (long)(nextWakeMillis() - millis());
+  return ((remaining > 0) ? (unsigned long)remaining : 0);
 }
 
 /**************************************************************************/
 /*!
-    @brief  Read the VEML7700's interrupt status register
-            <br>Note: reading the interrupt status register clears the interrupts.
-            <br>      So, we need to check both interrupt flags in a single read.
-    @param  status
-            <br>Will be set to the logical OR of ALS_IF_L and ALS_IF_H on return
-            <br>Possible values are:
-            <br>VEML7700_INT_STATUS_NONE
-            <br>VEML7700_INT_STATUS_HIGH
-            <br>VEML7700_INT_STATUS_LOW
-            <br>VEML7700_INT_STATUS_BOTH
-            <br>If an I2C error occurred, status will be:
-            <br>VEML7700_INT_STATUS_INVALID
+    @brief  Set how much change is stable and how much is fast
+            <br>The change is the difference between each sample and the EMA, divided by the EMA
+    @param  stableChange
+            <br>Samples which change less than this are stable. The default is 0.05 (5%)
+    @param  fastChange
+            <br>A sample which changes by this or more selects the fast level. The default is 0.25 (25%)
+    @param  stableSamples
+            <br>The number of stable samples in a row needed to lengthen the interval. The default is 4
+*/
+/**************************************************************************/
+void VEML7700AdaptiveScheduler::setChangeThresholds(float stableChange, float fastChange, uint8_t stableSamples)
+{
+  _stableChange = stableChange;
+  _fastChange = fastChange;
+  _stableSamples = (stableSamples == 0) ? 1 : stableSamples;
+  _stableCount = 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set the integration times
+            <br>These are not used if auto-ranging is enabled
+    @param  fast
+            <br>The integration time for the fast level. The default is VEML7700_INTEGRATION_25ms
+    @param  normal
+            <br>The integration time for the other levels. The default is VEML7700_INTEGRATION_100ms
     @return VEML7700_SUCCESS (VEML7700_ERROR_SUCCESS) if successful
 */
 /**************************************************************************/
-VEML7700_error_t VEML7700::getInterruptStatus(VEML7700_interrupt_status_t *status)
+VEML7700_error_t VEML7700AdaptiveScheduler::setIntegrationTimes(VEML7700_integration_time_t fast, VEML7700_integration_time_t normal)
 {
-  VEML7700_error_t err;
-  VEML7700_INTERRUPT_STATUS_REGISTER_t isr;
+  if ((fast >= VEML7700_INTEGRATION_INVALID) || (normal >= VEML7700_INTEGRATION_INVALID))
+    return (VEML7700_ERROR_UNDEFINED);
 
-  err = readI2CRegister((VEML7700_t *)&isr, VEML7700_INTERRUPT_STATUS);
+  _fastIntegration = fast;
+  _normalIntegration = normal;
 
-  if (err == VEML7700_ERROR_SUCCESS)
-  {
-    *status = (VEML7700_interrupt_status_t)isr.INT_STATUS_REG_INT_FLAGS;
-  }
-  else
-  {
-    *status = VEML7700_INT_STATUS_INVALID;
-  }
+  if ((_sensor == NULL) || _sensor->isAutoRangeEnabled())
+    return (VEML7700_ERROR_SUCCESS);
 
-  return (err);
+  return (_sensor->setIntegrationTime((_level == 0) ? _fastIntegration : _normalIntegration));
 }
 
 /**************************************************************************/
 /*!
-    @brief  Read the VEML7700's interrupt status register
-            <br>Note: reading the interrupt status register clears the interrupts.
-            <br>      So, we need to check both interrupt flags in a single read.
-    @return If successful:
-            <br>VEML7700_INT_STATUS_NONE
-            <br>VEML7700_INT_STATUS_HIGH
-            <br>VEML7700_INT_STATUS_LOW
-            <br>VEML7700_INT_STATUS_BOTH
-            <br>Otherwise:
-            <br>VEML7700_INT_STATUS_INVALID
+    @brief  Set the longest shut down interval
+    @param  maxMillis
+            <br>The interval in milliseconds. The default is 60000. The minimum is 8000
 */
 /**************************************************************************/
-VEML7700_interrupt_status_t VEML7700::getInterruptStatus()
+void VEML7700AdaptiveScheduler::setMaxIntervalMillis(unsigned long maxMillis)
 {
-  VEML7700_error_t err;
-  VEML7700_INTERRUPT_STATUS_REGISTER_t isr;
+  _maxInterval = (maxMillis < VEML7700_SCHEDULER_MIN_SLEEP_ms) ? VEML7700_SCHEDULER_MIN_SLEEP_ms : maxMillis;
+}
 
-  err = readI2CRegister((VEML7700_t *)&isr, VEML7700_INTERRUPT_STATUS);
+/**************************************************************************/
+/*!
+    @brief  Get the time between samples at the current level
+    @return The interval in milliseconds
+*/
+/**************************************************************************/
+unsigned long VEML7700AdaptiveScheduler::getIntervalMillis()
+{
+  if (_level >= VEML7700_SCHEDULER_SLEEP_LEVEL)
+    return (sleepIntervalMillis(_level));
 
-  if (err != VEML7700_ERROR_SUCCESS)
-    return (VEML7700_INT_STATUS_INVALID);
+  if (_sensor == NULL)
+    return (0);
 
-  return ((VEML7700_interrupt_status_t)isr.INT_STATUS_REG_INT_FLAGS);  
+  return (_sensor->getMeasurementPeriodMillis());
 }
 
-VEML7700_error_t VEML7700::readI2CBuffer(uint8_t *dest, VEML7700_registers_t startRegister, uint16_t len)
+VEML7700_error_t VEML7700AdaptiveScheduler::applyLevel(uint8_t level, bool force)
 {
-  _i2cPort->beginTransmission(_deviceAddress);
-  _i2cPort->write(startRegister);
-  if (_i2cPort->endTransmission(false) != 0)
-  {
-    if (_debugEnabled) _debugPort->println(F("VEML7700::readI2CBuffer: endTransmission error"));
-    return VEML7700_ERROR_READ;
-  }
+  VEML7700_error_t err = VEML7700_ERROR_SUCCESS;
+  bool fast = (level == 0);
+  bool powerSave = (level >= 2) && (level < VEML7700_SCHEDULER_SLEEP_LEVEL);
+  bool wasPowerSave = (_level >= 2) && (_level < VEML7700_SCHEDULER_SLEEP_LEVEL);
 
-  _i2cPort->requestFrom(_deviceAddress, (uint8_t)len);
-  if (_debugEnabled)
-  {
-    _debugPort->print(F("VEML7700::readI2CBuffer: register: 0x"));
-    _debugPort->println(startRegister, HEX);
-    _debugPort->print(F("VEML7700::readI2CBuffer: device returned:"));
-  }
-  for (uint16_t i = 0; i < len; i++)
-  {
-    dest[i] = _i2cPort->read();
-    if (_debugEnabled)
-    {
-    _debugPort->print(F(" 0x"));
-    _debugPort->print(dest[i], HEX);
-    }
-  }
-  if (_debugEnabled) _debugPort->println(F(""));
+  // Only write what changes. The auto-range owns the integration time if it is enabled
+  if (!_sensor->isAutoRangeEnabled() && (force || (fast != (_level == 0))))
+    err = _sensor->setIntegrationTime(fast ? _fastIntegration : _normalIntegration);
 
-  return VEML7700_ERROR_SUCCESS;
-}
+  if ((err == VEML7700_ERROR_SUCCESS) && powerSave && (force || (level != _level)))
+    err = _sensor->setPowerSaveMode((VEML7700_power_save_mode_t)(level - 2));
 
-VEML7700_error_t VEML7700::writeI2CBuffer(uint8_t *src, VEML7700_registers_t startRegister, uint16_t len)
-{
-  _i2cPort->beginTransmission(_deviceAddress);
-  _i2cPort->write(startRegister);
-  for (uint16_t i = 0; i < len; i++)
-  {
-    _i2cPort->write(src[i]);
-  }
-  if (_i2cPort->endTransmission(true) != 0)
-  {
-    return VEML7700_ERROR_WRITE;
-  }
-  return VEML7700_ERROR_SUCCESS;
-}
+  if ((err == VEML7700_ERROR_SUCCESS) && (force || (powerSave != wasPowerSave)))
+    err = _sensor->setPowerSaveEnable(powerSave ? VEML7700_POWER_SAVE_ENABLE : VEML7700_POWER_SAVE_DISABLE);
 
-VEML7700_error_t VEML7700::readI2CRegister(VEML7700_t *dest, VEML7700_registers_t registerAddress)
-{
-  VEML7700_error_t err;
-  uint8_t tempDest[2];
-  err = readI2CBuffer(tempDest, registerAddress, VEML7700_REGISTER_LENGTH);
   if (err == VEML7700_ERROR_SUCCESS)
-  {
-    *dest = (tempDest[0]) | ((VEML7700_t)tempDest[1] << 8);
-  }
-  return err;
-}
+    _level = level;
 
-VEML7700_error_t VEML7700::writeI2CRegister(VEML7700_t data, VEML7700_registers_t registerAddress)
-{
-  uint8_t d[2];
-  // Write LSB first
-  d[0] = (uint8_t)(data & 0x00FF);
-  d[1] = (uint8_t)((data & 0xFF00) >> 8);
-  return writeI2CBuffer(d, registerAddress, VEML7700_REGISTER_LENGTH);
+  return (err);
 }
 
-VEML7700::VEML7700_config_integration_time_t VEML7700::integrationTimeConfig(VEML7700_integration_time_t it)
+unsigned long VEML7700AdaptiveScheduler::sleepIntervalMillis(uint8_t level)
 {
-  switch (it)
-  {
-    case VEML7700_INTEGRATION_25ms:
-      return (VEML7700_CONFIG_INTEGRATION_25ms);
-      break;
-    case VEML7700_INTEGRATION_50ms:
-      return (VEML7700_CONFIG_INTEGRATION_50ms);
-      break;
-    case VEML7700_INTEGRATION_100ms:
-      return (VEML7700_CONFIG_INTEGRATION_100ms);
-      break;
-    case VEML7700_INTEGRATION_200ms:
-      return (VEML7700_CONFIG_INTEGRATION_200ms);
-      break;
-    case VEML7700_INTEGRATION_400ms:
-      return (VEML7700_CONFIG_INTEGRATION_400ms);
-      break;
-    case VEML7700_INTEGRATION_800ms:
-      return (VEML7700_CONFIG_INTEGRATION_800ms);
-      break;
-    default:
-      break;
-  }
-  return (VEML7700_CONFIG_INTEGRATION_INVALID);
-}
+  uint8_t doublings = level - VEML7700_SCHEDULER_SLEEP_LEVEL;
 
-VEML7700_integration_time_t VEML7700::integrationTimeFromConfig(VEML7700::VEML7700_config_integration_time_t it)
-{
-  switch (it)
-  {
-    case VEML7700_CONFIG_INTEGRATION_25ms:
-      return (VEML7700_INTEGRATION_25ms);
-      break;
-    case VEML7700_CONFIG_INTEGRATION_50ms:
-      return (VEML7700_INTEGRATION_50ms);
-      break;
-    case VEML7700_CONFIG_INTEGRATION_100ms:
-      return (VEML7700_INTEGRATION_100ms);
-      break;
-    case VEML7700_CONFIG_INTEGRATION_200ms:
-      return (VEML7700_INTEGRATION_200ms);
-      break;
-    case VEML7700_CONFIG_INTEGRATION_400ms:
-      return (VEML7700_INTEGRATION_400ms);
-      break;
-    case VEML7700_CONFIG_INTEGRATION_800ms:
-      return (VEML7700_INTEGRATION_800ms);
-      break;
-    default:
-      break;
-  }
-  return (VEML7700_INTEGRATION_INVALID);
+  // The interval stops doubling at the maximum, so this cannot overflow
+  if ((doublings >= 20) || (((unsigned long)VEML7700_SCHEDULER_MIN_SLEEP_ms << doublings) >= _maxInterval))
+    return (_maxInterval);
+
+  return ((unsigned long)VEML7700_SCHEDULER_MIN_SLEEP_ms << doublings);
 }
@@ -23,6 +23,16 @@
 #include <Arduino.h>
 #include <Wire.h>
 
+/** Uncomment the next line (or add -DVEML7700_DISABLE_DEBUG to your build flags) to remove
+    all of the debug code and messages. This saves flash and RAM, and takes the debug checks
+    out of the I2C code. enableDebugging and disableDebugging will then do nothing. */
+//#define VEML7700_DISABLE_DEBUG
+
+/** Uncomment the next line (or add -DVEML7700_ENABLE_BUS_STATS to your build flags) to count
+    the I2C transactions, bytes, errors and transaction times (see getStats). This is off by default:
+    when it is off, the counters and their code are compiled out. */
+//#define VEML7700_ENABLE_BUS_STATS
+
 typedef uint16_t VEML7700_t;
 
 /**  VEML7700 I2C address */
@@ -31,6 +41,10 @@ typedef uint16_t VEML7700_t;
 /** VEML7700 error code returns */
 typedef enum
 {
+  VEML7700_ERROR_UNDERRANGE = -8, // The ALS count is close to zero. A more sensitive range is available. (The lux is still returned)
+  VEML7700_ERROR_SATURATED = -7, // The ALS count is 0xFFFF. The lux is at least the value returned
+  VEML7700_ERROR_BUSY = -6, // An asynchronous read is already in progress, or the bus lock timed out
+  VEML7700_ERROR_NOT_READY = -5, // A new conversion is not available yet (see poll)
   VEML7700_ERROR_READ = -4,
   VEML7700_ERROR_WRITE = -3,
   VEML7700_ERROR_INVALID_ADDRESS = -2,
@@ -39,6 +53,22 @@ typedef enum
 } VEML7700_error_t;
 const VEML7700_error_t VEML7700_SUCCESS = VEML7700_ERROR_SUCCESS;
 
+/** The number of error codes (VEML7700_ERROR_UNDEFINED to VEML7700_ERROR_UNDERRANGE) */
+#define VEML7700_NUM_ERROR_CODES 8
+
+/** I2C bus statistics (see getStats). Only updated if VEML7700_ENABLE_BUS_STATS is defined */
+typedef struct
+{
+  uint32_t reads; // Read transactions
+  uint32_t writes; // Write transactions
+  uint32_t bytes; // Bytes transferred, including the command codes
+  uint32_t nacks; // Transactions the transport failed (VEML7700_ERROR_READ / VEML7700_ERROR_WRITE)
+  uint32_t errors[VEML7700_NUM_ERROR_CODES]; // Failed transactions, by code. errors[0] is VEML7700_ERROR_UNDEFINED, errors[1] is VEML7700_ERROR_INVALID_ADDRESS, etc.
+  unsigned long minMicros; // Transaction time. 0 if there have been no transactions
+  unsigned long averageMicros;
+  unsigned long maxMicros;
+} VEML7700_bus_stats_t;
+
 /** Sensitivity mode selection */
 typedef enum
 {
@@ -99,6 +129,144 @@ typedef enum
   VEML7700_SHUTDOWN_INVALID
 } VEML7700_shutdown_t;
 
+/** Power saving mode enable setting (PSM_EN) */
+typedef enum
+{
+  VEML7700_POWER_SAVE_DISABLE,
+  VEML7700_POWER_SAVE_ENABLE,
+  VEML7700_POWER_SAVE_INVALID
+} VEML7700_power_save_enable_t;
+
+/** Power saving mode selection (PSM). Selects the wait time between conversions */
+typedef enum
+{
+  VEML7700_POWER_SAVE_MODE_1, // 500ms
+  VEML7700_POWER_SAVE_MODE_2, // 1000ms
+  VEML7700_POWER_SAVE_MODE_3, // 2000ms
+  VEML7700_POWER_SAVE_MODE_4, // 4000ms
+  VEML7700_POWER_SAVE_MODE_INVALID
+} VEML7700_power_save_mode_t;
+
+/** The quality of the last lux reading */
+typedef enum
+{
+  VEML7700_SAMPLE_VALID,
+  VEML7700_SAMPLE_SATURATED, // The ALS count was 0xFFFF
+  VEML7700_SAMPLE_UNDERRANGE, // The ALS count was close to zero, and a more sensitive range is available
+  VEML7700_SAMPLE_INVALID // No reading yet, or the read failed
+} VEML7700_sample_quality_t;
+
+/** What the lux reads do with saturated and under range samples */
+typedef enum
+{
+  VEML7700_SATURATION_IGNORE, // Return the lux as normal. Check getSampleQuality if needed
+  VEML7700_SATURATION_REPORT, // Return VEML7700_ERROR_SATURATED or VEML7700_ERROR_UNDERRANGE
+  VEML7700_SATURATION_RETRY, // Change the range and read again. Report the error if the range limit is reached
+  VEML7700_SATURATION_INVALID
+} VEML7700_saturation_handling_t;
+
+/** The complete ALS configuration. Written with a single I2C transaction by applyConfiguration */
+typedef struct
+{
+  VEML7700_shutdown_t shutdown;
+  VEML7700_interrupt_enable_t interruptEnable;
+  VEML7700_persistence_protect_t persistenceProtect;
+  VEML7700_integration_time_t integrationTime;
+  VEML7700_sensitivity_mode_t sensitivityMode;
+} VEML7700_config_t;
+
+/** Completion callback for an asynchronous transfer. Called once, with the result of the transfer.
+    Note: this may be called from interrupt context, depending on the transport */
+typedef void (*VEML7700_transfer_callback_t)(VEML7700_error_t err, void *context);
+
+/** Completion callbacks for readAmbientLightAsync and readLuxAsync.
+    Note: these may be called from interrupt context, depending on the transport */
+typedef void (*VEML7700_ambient_callback_t)(VEML7700_error_t err, uint16_t ambient, void *context);
+typedef void (*VEML7700_lux_callback_t)(VEML7700_error_t err, float lux, void *context);
+
+/** The maximum number of VEML7700s that can use attachInterruptPin at the same time */
+#define VEML7700_MAX_INTERRUPT_PINS 4
+
+/** A point in the piecewise-linear calibration table (see setCalibrationTable) */
+typedef struct
+{
+  float lux; // The lux (after the calibration gain and offset)
+  float calibratedLux; // The reference lux
+} VEML7700_calibration_point_t;
+
+#define VEML7700_MAX_CALIBRATION_POINTS 6
+
+/** The size of the saveState / restoreState snapshot in bytes */
+#define VEML7700_STATE_SIZE 20
+
+/** Threshold event callback, called by service (not from the ISR) */
+typedef void (*VEML7700_threshold_callback_t)(void *context);
+
+/** Window tracking callback, called by service with the reading the new window is centred on */
+typedef void (*VEML7700_change_callback_t)(uint16_t ambient, float lux, void *context);
+
+/** Sink callback, called by poll with each reading that passes the sink's filters (see addSink) */
+typedef void (*VEML7700_sink_callback_t)(uint16_t ambient, float lux, void *context);
+
+#define VEML7700_MAX_SINKS 4
+
+/** Bus lock callbacks, used to share the I2C bus between RTOS tasks (see setBusLock).
+    acquire returns true once the lock is held, or false if it could not be taken (e.g. a timeout) */
+typedef bool (*VEML7700_lock_acquire_t)(void *context);
+typedef void (*VEML7700_lock_release_t)(void *context);
+
+/** The flicker analysis frequencies: mains, and the double mains from full-wave rectified drivers */
+typedef enum
+{
+  VEML7700_FLICKER_50Hz = 0,
+  VEML7700_FLICKER_60Hz,
+  VEML7700_FLICKER_100Hz,
+  VEML7700_FLICKER_120Hz,
+  VEML7700_FLICKER_INVALID
+} VEML7700_flicker_frequency_t;
+
+/** Bus recovery callback (see setBusRecovery). Return true if the bus was recovered */
+typedef bool (*VEML7700_bus_recovery_t)(void *context);
+
+/** The I2C transport used to communicate with the VEML7700.
+    Derive from this to use a DMA, interrupt-driven or RTOS I2C driver instead of TwoWire.
+    Each read or write is one register access: the command code (register) followed by len bytes. */
+class VEML7700Transport
+{
+public:
+  /** Blocking read and write */
+  virtual VEML7700_error_t read(uint8_t address, uint8_t reg, uint8_t *dest, uint8_t len) = 0;
+  virtual VEML7700_error_t write(uint8_t address, uint8_t reg, const uint8_t *src, uint8_t len) = 0;
+
+  /** Start a read and return immediately. callback is called when the read completes.
+      Return an error (and do not call callback) only if the read could not be started.
+      The default calls read, then callback, before returning. */
+  virtual VEML7700_error_t readAsync(uint8_t address, uint8_t reg, uint8_t *dest, uint8_t len,
+                                     VEML7700_transfer_callback_t callback, void *context);
+};
+
+/** The default transport: blocking TwoWire (Wire) transactions */
+class VEML7700TwoWireTransport : public VEML7700Transport
+{
+public:
+  VEML7700TwoWireTransport(TwoWire &wirePort = Wire) { _i2cPort = &wirePort; };
+  void setPort(TwoWire &wirePort) { _i2cPort = &wirePort; };
+  TwoWire *getPort() { return _i2cPort; };
+
+  VEML7700_error_t read(uint8_t address, uint8_t reg, uint8_t *dest, uint8_t len);
+  VEML7700_error_t write(uint8_t address, uint8_t reg, const uint8_t *src, uint8_t len);
+
+  /** Free a stuck bus by clocking SCL, then send a STOP. Call Wire.begin() afterwards */
+  static bool clearBus(uint8_t sdaPin, uint8_t sclPin);
+
+protected:
+  TwoWire *_i2cPort;
+};
+
+class VEML7700SampleBufferBase;
+class VEML7700Statistics;
+class VEML7700Flicker;
+
 /** Communication interface for the VEML7700 */
 class VEML7700
 {
@@ -108,15 +276,63 @@ public:
 
   /** Begin the VEML7700. Default to Wire */
   bool begin(TwoWire &wirePort = Wire);
+  /** Begin the VEML7700 using a custom transport. The transport must outlive the VEML7700 */
+  bool begin(VEML7700Transport &transport);
+
+  /** Hold a lock (e.g. a FreeRTOS mutex) across each register transaction.
+      No lock is used by default. Pass NULL to remove the lock. */
+  void setBusLock(VEML7700_lock_acquire_t acquire, VEML7700_lock_release_t release, void *context = NULL);
+
+  /** Error recovery. Failed transactions are retried with a doubling back off. The recovery callback
+      is called before the second and later retries. No retries by default. */
+  void setRetries(uint8_t retries, unsigned int backoffMicros = 100);
+  void setBusRecovery(VEML7700_bus_recovery_t recovery, void *context = NULL);
+
+  /** Detect unexpected sensor resets (e.g. brown-outs) and restore the configuration,
+      power saving mode and thresholds last written. Disabled by default. */
+  void enableResetRecovery(unsigned long checkIntervalMillis = 0);
+  void disableResetRecovery();
+  VEML7700_error_t checkConfiguration();
+  uint16_t getResetCount() { return _resetCount; };
 
-  /** Enable debug messages. Default to Serial */
+  /** I2C bus statistics. getStats returns VEML7700_ERROR_UNDEFINED if VEML7700_ENABLE_BUS_STATS is not defined */
+  VEML7700_error_t getStats(VEML7700_bus_stats_t *stats);
+  void resetStats();
+
+  /** Enable debug messages. Default to Serial.
+      Note: these do nothing if VEML7700_DISABLE_DEBUG is defined */
   void enableDebugging(Stream &debugPort = Serial);
   void disableDebugging();
 
   bool isConnected();
 
+  /** Configuration cache. Disabled by default.
+      When enabled, the configuration is only read over I2C on begin, after an error,
+      or when syncConfiguration is called */
+  void enableConfigurationCache();
+  void disableConfigurationCache();
+  VEML7700_error_t syncConfiguration();
+
+  /** Warm start. saveState writes a VEML7700_STATE_SIZE byte snapshot of the configuration,
+      power saving mode, thresholds, auto-range enable and calibration, for EEPROM / NVS / flash.
+      Call restoreState before begin, and begin comes up straight in the saved range. */
+  VEML7700_error_t saveState(uint8_t *state, uint16_t length = VEML7700_STATE_SIZE);
+  VEML7700_error_t restoreState(const uint8_t *state, uint16_t length = VEML7700_STATE_SIZE);
+
+  /** Per-unit calibration: lux = (datasheet lux * gain) + offset. Default is gain 1.0, offset 0.0 */
+  VEML7700_error_t setCalibration(float gain, float offset = 0.0);
+  void getCalibration(float *gain, float *offset);
+  /** Apply the calibration to a datasheet lux, e.g. from VEML7700Statistics or VEML7700SampleBuffer (which hold raw counts) */
+  float applyCalibration(float lux) { return (applyCalibrationTable((lux * _calibrationGain) + _calibrationOffset)); };
+  /** Optional piecewise-linear table, applied after the gain and offset. The table is not copied */
+  VEML7700_error_t setCalibrationTable(const VEML7700_calibration_point_t *table, uint8_t points);
+
   /** Configuration controls */
 
+  /** Write all of the configuration settings in a single transaction */
+  VEML7700_error_t applyConfiguration(const VEML7700_config_t &config);
+  VEML7700_error_t getConfiguration(VEML7700_config_t *config);
+
   VEML7700_error_t setShutdown(VEML7700_shutdown_t);
   VEML7700_error_t powerOn() { return setShutdown(VEML7700_POWER_ON); };
   VEML7700_error_t shutdown() { return setShutdown(VEML7700_SHUT_DOWN); };
@@ -130,16 +346,32 @@ public:
   VEML7700_error_t getPersistenceProtect(VEML7700_persistence_protect_t *pp);
   VEML7700_persistence_protect_t getPersistenceProtect();
   const char * getPersistenceProtectStr();
+  const __FlashStringHelper * getPersistenceProtectFlashStr();
 
   VEML7700_error_t setIntegrationTime(VEML7700_integration_time_t it);
   VEML7700_error_t getIntegrationTime(VEML7700_integration_time_t *it);
   VEML7700_integration_time_t getIntegrationTime();
   const char * getIntegrationTimeStr();
+  const __FlashStringHelper * getIntegrationTimeFlashStr();
 
   VEML7700_error_t setSensitivityMode(VEML7700_sensitivity_mode_t sm);
   VEML7700_error_t getSensitivityMode(VEML7700_sensitivity_mode_t *sm);
   VEML7700_sensitivity_mode_t getSensitivityMode();
   const char * getSensitivityModeStr();
+  const __FlashStringHelper * getSensitivityModeFlashStr();
+
+  /** Power saving mode controls. When enabled, the sensor waits between conversions.
+      The wait is included in getMeasurementPeriodMillis, so poll is scheduled correctly. */
+
+  VEML7700_error_t setPowerSaveEnable(VEML7700_power_save_enable_t pe);
+  VEML7700_error_t getPowerSaveEnable(VEML7700_power_save_enable_t *pe);
+  VEML7700_power_save_enable_t getPowerSaveEnable();
+
+  VEML7700_error_t setPowerSaveMode(VEML7700_power_save_mode_t psm);
+  VEML7700_error_t getPowerSaveMode(VEML7700_power_save_mode_t *psm);
+  VEML7700_power_save_mode_t getPowerSaveMode();
+  const char * getPowerSaveModeStr();
+  const __FlashStringHelper * getPowerSaveModeFlashStr();
 
   VEML7700_error_t setHighThreshold(uint16_t threshold);
   VEML7700_error_t getHighThreshold(uint16_t *threshold);
@@ -149,6 +381,18 @@ public:
   VEML7700_error_t getLowThreshold(uint16_t *threshold);
   uint16_t getLowThreshold();
 
+  /** Thresholds in lux. The lux targets are stored, and the threshold registers are
+      rewritten (straight after the configuration) whenever the gain or integration time changes.
+      Setting a raw threshold (setHighThreshold / setLowThreshold) cancels the lux target.
+      Note: the thresholds are compared with the ALS count, so the non-linearity correction is not applied. */
+  VEML7700_error_t setHighThresholdLux(float lux);
+  VEML7700_error_t getHighThresholdLux(float *lux);
+  float getHighThresholdLux();
+
+  VEML7700_error_t setLowThresholdLux(float lux);
+  VEML7700_error_t getLowThresholdLux(float *lux);
+  float getLowThresholdLux();
+
   /** Read the sensor data */
 
   VEML7700_error_t getAmbientLight(uint16_t *ambient);
@@ -157,14 +401,123 @@ public:
   VEML7700_error_t getWhiteLevel(uint16_t *whiteLevel);
   uint16_t getWhiteLevel();
 
+  /** Read the ALS and WHITE levels from the same conversion */
+  VEML7700_error_t getAmbientAndWhite(uint16_t *ambient, uint16_t *whiteLevel, bool verify = true);
+
+  /** Burst reads of back-to-back conversions, for fast transients and flicker. These are blocking.
+      Use the 25ms or 50ms integration time for the highest sample rate. The mean variants
+      oversample to recover the SNR of a longer integration. */
+  VEML7700_error_t getAmbientLightBurst(uint16_t *ambient, uint16_t count, unsigned long *timestampsMicros = NULL);
+  VEML7700_error_t getAmbientLightBurstMean(float *ambient, uint16_t count);
+  VEML7700_error_t getLuxBurst(float *lux, uint16_t count);
+
+  /** Flicker analysis. Reads count evenly spaced samples into buffer, then analyses them.
+      This is blocking. Use the 25ms integration time. */
+  VEML7700_error_t measureFlicker(VEML7700Flicker *flicker, uint16_t *buffer, uint16_t count);
+
   VEML7700_error_t getLux(float *lux);
   float getLux();
 
+  /** Integer lux, in millilux (lux * 1000). Uses no floating point. */
+  VEML7700_error_t getLuxMilli(uint32_t *milliLux);
+  uint32_t getLuxMilli();
+
+  /** Lux with the non-linearity correction from the VEML7700 Application Note.
+      The correction is only applied above 1000 lux. It corrects the sensor, so it is applied to
+      the datasheet lux before the per-unit calibration (setCalibration / setCalibrationTable).
+      At or below 1000 lux these are getLux and getLuxMilli, plus one compare of the ALS count. */
+  VEML7700_error_t getLuxCorrected(float *lux);
+  float getLuxCorrected();
+  VEML7700_error_t getLuxCorrectedMilli(uint32_t *milliLux);
+  uint32_t getLuxCorrectedMilli();
+
+  /** Asynchronous reads. These start the ALS read and return immediately.
+      callback is called with the result when the transport completes the read.
+      Only one asynchronous read can be in progress: a second returns VEML7700_ERROR_BUSY.
+      The lux calculation uses the configuration shadow copy. Enable the configuration cache
+      to keep readLuxAsync completely non-blocking (otherwise the configuration is read first). */
+  VEML7700_error_t readAmbientLightAsync(VEML7700_ambient_callback_t callback, void *context = NULL);
+  VEML7700_error_t readLuxAsync(VEML7700_lux_callback_t callback, void *context = NULL);
+  bool isAsyncBusy() { return _asyncBusy; };
+
+  /** Saturation and under range detection. Applies to getLux, getLuxMilli, the corrected versions and poll.
+      With VEML7700_SATURATION_RETRY, the blocking reads change the range and wait for a new conversion,
+      poll changes the range and returns VEML7700_ERROR_NOT_READY. Bad samples are not added to the
+      sample buffer or statistics unless the handling is VEML7700_SATURATION_IGNORE. */
+  void setSaturationHandling(VEML7700_saturation_handling_t handling);
+  VEML7700_saturation_handling_t getSaturationHandling() { return _saturationHandling; };
+  VEML7700_sample_quality_t getSampleQuality() { return _sampleQuality; };
+
+  /** Non-blocking sampling, timed with millis() and the integration time.
+      Call startMeasurement once, then call poll as often as you like.
+      poll returns VEML7700_ERROR_NOT_READY until a fresh conversion is available. */
+  VEML7700_error_t startMeasurement();
+  bool isMeasurementReady();
+  /** The millis() at which the next conversion will be ready. Valid after startMeasurement */
+  unsigned long getMeasurementReadyMillis() { return _nextSampleMillis; };
+  VEML7700_error_t poll(float *lux);
+  VEML7700_error_t poll(uint32_t *milliLux);
+  unsigned long getMeasurementPeriodMillis();
+  /** Store each reading returned by poll in a sample buffer. NULL to stop */
+  void setSampleBuffer(VEML7700SampleBufferBase *buffer) { _sampleBuffer = buffer; };
+  /** Add each reading returned by poll to a statistics stage. NULL to stop */
+  void setStatistics(VEML7700Statistics *statistics) { _statistics = statistics; };
+  /** Publish each poll reading to up to VEML7700_MAX_SINKS callbacks. One ALS read serves them all.
+      Each sink can take every nth reading, and only those that have changed by changeThresholdLux */
+  VEML7700_error_t addSink(VEML7700_sink_callback_t callback, void *context = NULL, uint8_t decimation = 1, float changeThresholdLux = 0.0);
+  VEML7700_error_t removeSink(VEML7700_sink_callback_t callback, void *context = NULL);
+  uint8_t getSinkCount() { return _sinkCount; };
+
+  /** Automatic gain and integration time ranging, used by poll and getAutoRangedLux */
+  void enableAutoRange();
+  void disableAutoRange();
+  bool isAutoRangeEnabled() { return _autoRange; };
+  void setAutoRangeThresholds(uint16_t low, uint16_t high);
+  uint8_t getAutoRangeConversions();
+  VEML7700_error_t getAutoRangedLux(float *lux);
+  unsigned long getAutoRangeWorstCaseMillis(VEML7700_sensitivity_mode_t sm, VEML7700_integration_time_t it);
+
   /** Note: reading the interrupt status register clears the interrupts.
             So, we need to check both interrupt flags in a single read. */
   VEML7700_error_t getInterruptStatus(VEML7700_interrupt_status_t *status);
   VEML7700_interrupt_status_t getInterruptStatus();
 
+  /** Interrupt pin driven threshold events.
+      Note: the VEML7700 itself has no INT pin. These are for boards using a pin-compatible
+            sensor (e.g. the VEML6030) with its INT line connected to a GPIO.
+      The ISR only sets a flag. service reads the interrupt status (over I2C) only when the flag
+      is set, and calls the high and low threshold callbacks. */
+  VEML7700_error_t attachInterruptPin(uint8_t pin);
+  void detachInterruptPin();
+  void setHighThresholdCallback(VEML7700_threshold_callback_t callback, void *context = NULL);
+  void setLowThresholdCallback(VEML7700_threshold_callback_t callback, void *context = NULL);
+  VEML7700_error_t service();
+  bool isInterruptPending() { return _interruptPending; };
+
+  /** Window tracking: the sensor as a change detector. After each threshold event, service reads
+      the ALS and re-centres the threshold window on it (+/- percent). The callback is called
+      with each new reading. The window is kept in lux, so it follows range changes. */
+  VEML7700_error_t enableWindowTracking(uint8_t percent, VEML7700_persistence_protect_t pp = VEML7700_PERSISTENCE_4);
+  void disableWindowTracking();
+  void setWindowChangeCallback(VEML7700_change_callback_t callback, void *context = NULL);
+  /** Called by the ISR. Call this from your own ISR if you are not using attachInterruptPin */
+  void interruptHandler() { _interruptPending = true; };
+
+protected:
+  /** Hooks for VEML7700Fixed. Everything else is private */
+  /** Write the fixed configuration, disable power saving mode and trust the shadow copy from then on */
+  bool beginFixed(TwoWire &wirePort, VEML7700_t configuration);
+  bool beginFixed(VEML7700Transport &transport, VEML7700_t configuration);
+  /** Read the ALS and apply the saturation handling. The range is fixed, so
+      VEML7700_SATURATION_RETRY reports the error the same as VEML7700_SATURATION_REPORT */
+  VEML7700_error_t readFixedAmbient(uint16_t *ambient);
+  bool isCalibrated() { return (_calibrated); };
+  /** Convert an ALS count using the gain and integration time from the shadow copy */
+  float luxFromAmbient(uint16_t ambient);
+  uint32_t milliLuxFromAmbient(uint16_t ambient);
+  /** True if the lux has been set: success, or a saturated / under range reading */
+  bool luxIsValid(VEML7700_error_t err) { return ((err == VEML7700_ERROR_SUCCESS) || (err == VEML7700_ERROR_SATURATED) || (err == VEML7700_ERROR_UNDERRANGE)); };
+
 private:
 
   /** Provide bit field access to the configuration register */
@@ -187,6 +540,25 @@ private:
     };
   } VEML7700_CONFIGURATION_REGISTER_t;
   VEML7700_CONFIGURATION_REGISTER_t _configurationRegister;
+  bool _cacheConfiguration; // True if _configurationRegister is to be used as a shadow copy
+  bool _configurationValid; // True if _configurationRegister matches the sensor
+
+  /** Provide bit field access to the power saving mode register */
+  typedef struct
+  {
+    union
+    {
+      VEML7700_t all;
+      struct
+      {
+        VEML7700_t POWER_SAVE_REG_PSM_EN : 1; // Power saving mode enable
+        VEML7700_t POWER_SAVE_REG_PSM : 2; // Power saving mode
+        VEML7700_t POWER_SAVE_REG_RES : 13; // Reserved
+      };
+    };
+  } VEML7700_POWER_SAVE_REGISTER_t;
+  VEML7700_POWER_SAVE_REGISTER_t _powerSaveRegister;
+  bool _powerSaveValid; // True if _powerSaveRegister matches the sensor
 
   /** Provide bit field access to the interrupt status register
       Note: reading the interrupt status register clears the interrupts.
@@ -212,7 +584,8 @@ private:
     VEML7700_CONFIGURATION_REGISTER,
     VEML7700_HIGH_THRESHOLD,
     VEML7700_LOW_THRESHOLD,
-    VEML7700_ALS_OUTPUT = 4,
+    VEML7700_POWER_SAVING,
+    VEML7700_ALS_OUTPUT,
     VEML7700_WHITE_OUTPUT,
     VEML7700_INTERRUPT_STATUS
   } VEML7700_registers_t;
@@ -229,10 +602,167 @@ private:
     VEML7700_CONFIG_INTEGRATION_INVALID
   } VEML7700_config_integration_time_t;
 
-  TwoWire *_i2cPort;
-  Stream *_debugPort;
+  /** Non-blocking sampling state */
+  bool _measurementActive; // True once startMeasurement has been called (and the sensor is powered on)
+  unsigned long _measurementPeriod; // The time between conversions (ms)
+  unsigned long _nextSampleMillis; // millis() when the next fresh conversion will be available
+  void restartMeasurementTimer();
+
+  VEML7700SampleBufferBase *_sampleBuffer; // Fed by pollAmbientLight
+  VEML7700Statistics *_statistics; // Fed by pollAmbientLight
+
+  /** The sinks. _sinks[0] to _sinks[_sinkCount - 1] are in use */
+  typedef struct
+  {
+    VEML7700_sink_callback_t callback;
+    void *context;
+    float changeThresholdLux; // 0.0 to publish every (decimated) reading
+    float lastLux; // The last lux published to this sink
+    uint8_t decimation;
+    uint8_t count; // Readings since the last decimated one
+    bool published; // True once lastLux is valid
+  } VEML7700_sink_t;
+  VEML7700_sink_t _sinks[VEML7700_MAX_SINKS];
+  uint8_t _sinkCount;
+  void publish(uint16_t ambient); // Fed by pollAmbientLight
+
+  /** Auto-range state */
+  bool _autoRange;
+  uint16_t _autoRangeLow; // Hysteresis band (ALS counts)
+  uint16_t _autoRangeHigh;
+  uint8_t _autoRangeConversions; // Conversions so far in the current convergence
+  uint8_t _lastAutoRangeConversions; // Conversions needed by the last convergence
+  uint8_t rangeCell(); // The auto-range ladder cell closest to the current configuration
+  uint16_t rangeCellResolution(uint8_t cell); // Units of 0.0001 lux per count
+  VEML7700_error_t setRangeCell(uint8_t cell);
+  VEML7700_error_t autoRangeStep(uint16_t ambient);
+
+  /** Saturation and under range handling */
+  VEML7700_saturation_handling_t _saturationHandling;
+  VEML7700_sample_quality_t _sampleQuality;
+  VEML7700_sample_quality_t sampleQuality(uint16_t ambient); // Uses the gain and integration time from the shadow copy
+  /** Set _sampleQuality. Apply _saturationHandling. If blocking is false, a retry only changes the range */
+  VEML7700_error_t checkSampleQuality(uint16_t *ambient, bool blocking);
+
+  /** Read the ALS and calculate the lux */
+  VEML7700_error_t readLux(float *lux, uint16_t *ambient);
+  /** Read the ALS if a fresh conversion is available. Steps the timer and the auto-range */
+  VEML7700_error_t pollAmbientLight(uint16_t *ambient);
+  /** Apply the non-linearity correction (above 1000 lux) to the datasheet (uncalibrated) lux.
+      The calibration is applied afterwards. correctMilliLux clamps to the sensor's full scale */
+  float correctLux(float lux);
+  uint32_t correctMilliLux(uint32_t milliLux);
+
+  /** Asynchronous read state */
+  volatile bool _asyncBusy;
+  VEML7700_ambient_callback_t _asyncAmbientCallback;
+  VEML7700_lux_callback_t _asyncLuxCallback;
+  void *_asyncContext;
+  uint8_t _asyncBuffer[2];
+  VEML7700_error_t readAsync(VEML7700_ambient_callback_t ambientCallback, VEML7700_lux_callback_t luxCallback, void *context);
+  static void asyncComplete(VEML7700_error_t err, void *context);
+
+  /** Lux thresholds */
+  float _highThresholdLux; // Negative if there is no lux target
+  float _lowThresholdLux;
+  VEML7700_t _thresholdRange; // The gain and integration time bits the threshold registers were scaled for
+  VEML7700_error_t writeLuxThresholds(); // Uses the shadow copy. Call readConfigurationRegister first if needed
+  /** Convert lux into the ALS count using the gain and integration time from the shadow copy */
+  uint16_t ambientFromLux(float lux);
+
+  /** Interrupt pin events */
+  volatile bool _interruptPending;
+  int16_t _interruptPin; // -1 if not attached
+  int8_t _interruptSlot; // Index into the ISR instance table
+  VEML7700_threshold_callback_t _highThresholdCallback;
+  void *_highThresholdContext;
+  VEML7700_threshold_callback_t _lowThresholdCallback;
+  void *_lowThresholdContext;
+
+  /** Window tracking */
+  uint8_t _windowPercent; // 0 if window tracking is disabled
+  VEML7700_change_callback_t _windowCallback;
+  void *_windowContext;
+  VEML7700_error_t centreWindow(uint16_t ambient);
+
+  /** Bus lock */
+  VEML7700_lock_acquire_t _busLockAcquire;
+  VEML7700_lock_release_t _busLockRelease;
+  void *_busLockContext;
+  bool lockBus() { return ((_busLockAcquire == NULL) || _busLockAcquire(_busLockContext)); };
+  void unlockBus() { if (_busLockRelease != NULL) _busLockRelease(_busLockContext); };
+
+  /** Calibration. The Q forms are used by the integer path and saveState */
+  float _calibrationGain;
+  float _calibrationOffset; // lux
+  uint32_t _calibrationGainQ16;
+  int32_t _calibrationOffsetMilli;
+  const VEML7700_calibration_point_t *_calibrationTable;
+  uint8_t _calibrationPoints;
+
+  /** The resolution and calibration gain, folded together for the current range by updateResolution */
+  bool _calibrated; // False if the calibration is the default (gain 1.0, offset 0.0, no table)
+  float _luxResolution; // Lux per count, including the calibration gain. Recalculated by luxFromCounts
+  bool _luxResolutionValid; // False if _luxResolution needs recalculating
+  uint32_t _milliResolutionQ16; // Millilux per count, including the calibration gain. Q16
+  uint16_t _correctionCounts; // The largest ALS count at or below VEML7700_CORRECTION_THRESHOLD_LUX (datasheet lux)
+  void updateResolution(); // Call whenever the configuration shadow or calibration changes
+  float luxFromCounts(float ambient);
+
+  /** The calibration table segments, calculated by setCalibrationTable. These are in lux
+      (after the calibration gain and offset), so they do not depend on the range */
+  float _tableSlope[VEML7700_MAX_CALIBRATION_POINTS - 1]; // Calibrated lux per lux, for each table segment
+  float _tableIntercept[VEML7700_MAX_CALIBRATION_POINTS - 1];
+  int32_t _tableSlopeQ16[VEML7700_MAX_CALIBRATION_POINTS - 1]; // Q16
+  int32_t _tableInterceptMilli[VEML7700_MAX_CALIBRATION_POINTS - 1];
+  int32_t _tableBreakMilli[VEML7700_MAX_CALIBRATION_POINTS - 2]; // The millilux at which each inner point starts a segment
+  /** Apply the table (if any) to the lux after the calibration gain and offset. Limited to 0 and above */
+  float applyCalibrationTable(float lux);
+  uint32_t applyCalibrationTableMilli(int64_t milliLux);
+
+  /** Warm start. restoreState holds the snapshot here until begin */
+  bool _restorePending;
+  VEML7700_t _restoredConfiguration;
+  VEML7700_t _restoredPowerSave;
+  VEML7700_t _restoredHighThreshold;
+  VEML7700_t _restoredLowThreshold;
+  bool _restoredAutoRange;
+  VEML7700_error_t applyRestoredState();
+  static void storeState(uint8_t *dest, uint32_t value, uint8_t len); // Little-endian
+  static uint32_t loadState(const uint8_t *src, uint8_t len);
+  static uint16_t stateChecksum(const uint8_t *state, uint8_t len);
+
+  /** Error recovery */
+  uint8_t _retries;
+  unsigned int _retryBackoffMicros;
+  VEML7700_bus_recovery_t _busRecovery;
+  void *_busRecoveryContext;
+  bool _resetRecovery;
+  unsigned long _resetCheckInterval;
+  unsigned long _lastResetCheck;
+  uint16_t _resetCount;
+  VEML7700_t _appliedConfiguration; // The register values last written, to restore after a reset
+  VEML7700_t _appliedPowerSave;
+  VEML7700_t _appliedHighThreshold;
+  VEML7700_t _appliedLowThreshold;
+  uint8_t _appliedRegisters; // Bit n is set once register n has been written
+  VEML7700_error_t restoreConfiguration();
+
+#ifdef VEML7700_ENABLE_BUS_STATS
+  /** Bus statistics */
+  VEML7700_bus_stats_t _stats;
+  unsigned long _totalMicros;
+  unsigned long _asyncStartMicros;
+  void recordTransaction(bool write, uint8_t len, VEML7700_error_t err, unsigned long startMicros);
+#endif
+
+  VEML7700TwoWireTransport _wireTransport; // Used by begin(TwoWire &)
+  VEML7700Transport *_transport;
   uint8_t _deviceAddress;
+#ifndef VEML7700_DISABLE_DEBUG
+  Stream *_debugPort;
   bool _debugEnabled;
+#endif
 
   VEML7700_error_t _connected(void);
 
@@ -241,12 +771,408 @@ private:
   VEML7700_error_t writeI2CBuffer(uint8_t *src, VEML7700_registers_t startRegister, uint16_t len);
   VEML7700_error_t readI2CRegister(VEML7700_t *dest, VEML7700_registers_t registerAddress);
   VEML7700_error_t writeI2CRegister(VEML7700_t data, VEML7700_registers_t registerAddress);
+  /** Burst reads. ambient, timestampsMicros, sum and maximum can be NULL */
+  VEML7700_error_t readBurst(uint16_t *ambient, uint16_t count, unsigned long *timestampsMicros, uint32_t *sum, uint16_t *maximum, bool synchronous);
+  /** The time between burst samples. A synchronous burst restarts the integration for each sample */
+  unsigned long burstPeriodMicros(bool synchronous);
+
+  /** One register transaction, with the bus lock, retries and bus statistics */
+  VEML7700_error_t transfer(bool write, uint8_t reg, uint8_t *data, uint8_t len);
+  /** Read count consecutive registers with back-to-back transactions */
+  VEML7700_error_t readI2CRegisters(VEML7700_t *dest, VEML7700_registers_t firstRegister, uint8_t count);
+
+  /** Configuration register access via the shadow copy */
+  VEML7700_error_t readConfigurationRegister();
+  VEML7700_error_t writeConfigurationRegister();
+  VEML7700_error_t readPowerSaveRegister();
+  VEML7700_error_t writePowerSaveRegister();
 
   /** Convert the (sequential) integration time into the corresponding (non-sequential) configuration value */
   VEML7700_config_integration_time_t integrationTimeConfig(VEML7700_integration_time_t it);
   /** Convert the (non-sequential) integration time config into the corresponding (sequential) integration time */
   VEML7700_integration_time_t integrationTimeFromConfig(VEML7700_config_integration_time_t it);
+  /** The time between conversions (ms) for integration time it, including the settling margin
+      and the power saving mode wait time (from the _powerSaveRegister shadow) */
+  unsigned long measurementPeriodMillis(VEML7700_integration_time_t it);
+
+};
+
+/** A VEML7700 with the gain (sensitivity) and integration time fixed at compile time.
+    The resolution and the configuration register value are compile-time constants.
+    begin writes the configuration once, and getLux (or getLuxMilli) is a single ALS read and one multiply.
+    If a calibration is set, getLux and getLuxMilli use the folded (calibrated) resolution instead.
+    The saturation handling applies as for VEML7700, except that the range is never changed:
+    VEML7700_SATURATION_RETRY reports VEML7700_ERROR_SATURATED or VEML7700_ERROR_UNDERRANGE like
+    VEML7700_SATURATION_REPORT.
+    Note: do not call setSensitivityMode, setIntegrationTime, applyConfiguration or enableAutoRange
+          on a VEML7700Fixed. */
+template <VEML7700_sensitivity_mode_t SM, VEML7700_integration_time_t IT>
+class VEML7700Fixed : public VEML7700
+{
+public:
+  static_assert(SM < VEML7700_SENSITIVITY_INVALID, "VEML7700Fixed: invalid sensitivity mode");
+  static_assert(IT < VEML7700_INTEGRATION_INVALID, "VEML7700Fixed: invalid integration time");
+
+  /** The resolution (lux per count). 0.0036 lux at x2 and 800ms, doubling for each
+      halving of the gain or integration time. Matches VEML7700_LUX_RESOLUTION. */
+  static constexpr float luxResolution()
+  {
+    return (0.0036f * (float)(gainFactor() << (VEML7700_INTEGRATION_800ms - IT)));
+  }
+
+  /** The configuration register value: powered on, interrupt disabled, persistence 1 */
+  static constexpr VEML7700_t configuration()
+  {
+    return ((VEML7700_t)(((VEML7700_t)SM << 11) | ((VEML7700_t)integrationTimeConfigBits() << 6)));
+  }
+
+  /** Begin the VEML7700. Default to Wire */
+  bool begin(TwoWire &wirePort = Wire) { return (beginFixed(wirePort, configuration())); }
+
+  /** Begin the VEML7700 using a custom transport */
+  bool begin(VEML7700Transport &transport) { return (beginFixed(transport, configuration())); }
+
+  /** Read the sensor data and calculate the lux */
+  VEML7700_error_t getLux(float *lux)
+  {
+    uint16_t ambient;
+    VEML7700_error_t err = readFixedAmbient(&ambient);
+
+    if (luxIsValid(err))
+      *lux = isCalibrated() ? luxFromAmbient(ambient) : (float)ambient * luxResolution();
+
+    return (err);
+  }
+
+  float getLux()
+  {
+    float lux = 0.0;
+    getLux(&lux);
+    return (lux);
+  }
+
+  /** The resolution in units of 0.0001 lux per count. Matches VEML7700_LUX_RESOLUTION_x10000. */
+  static constexpr uint16_t luxResolutionx10000()
+  {
+    return ((uint16_t)(36 * (gainFactor() << (VEML7700_INTEGRATION_800ms - IT))));
+  }
+
+  /** Read the sensor data and calculate the lux in millilux, using integer math only */
+  VEML7700_error_t getLuxMilli(uint32_t *milliLux)
+  {
+    uint16_t ambient;
+    VEML7700_error_t err = readFixedAmbient(&ambient);
+
+    if (luxIsValid(err))
+      *milliLux = isCalibrated() ? milliLuxFromAmbient(ambient) : (((uint32_t)ambient * luxResolutionx10000()) + 5) / 10;
+
+    return (err);
+  }
+
+  uint32_t getLuxMilli()
+  {
+    uint32_t milliLux = 0;
+    getLuxMilli(&milliLux);
+    return (milliLux);
+  }
+
+private:
+  /** Resolution multiplier for the gain, relative to x2 */
+  static constexpr uint16_t gainFactor()
+  {
+    return ((SM == VEML7700_SENSITIVITY_x2) ? 1 : (SM == VEML7700_SENSITIVITY_x1) ? 2 : (SM == VEML7700_SENSITIVITY_x1_4) ? 8 : 16);
+  }
+
+  /** The (non-sequential) ALS_IT value. See VEML7700_config_integration_time_t */
+  static constexpr uint16_t integrationTimeConfigBits()
+  {
+    return ((IT == VEML7700_INTEGRATION_25ms) ? 0b1100 : (IT == VEML7700_INTEGRATION_50ms) ? 0b1000 : (uint16_t)(IT - VEML7700_INTEGRATION_100ms));
+  }
+};
+
+/** Mux channel select callback for VEML7700Array.
+    channel is the value passed to addSensor - it can encode the mux address as well as the channel.
+    Return true if the channel was selected successfully. */
+typedef bool (*VEML7700_mux_select_t)(uint8_t channel, void *context);
+
+/** Manages many VEML7700s behind I2C muxes (e.g. TCA9548A). The VEML7700 address is fixed,
+    so each sensor needs its own mux channel. The sensors are swept in channel order so that
+    each channel is selected only once per sweep. All integrations are started together,
+    so a sweep takes about one measurement period, not one per sensor.
+    Sensors which fail begin or startSweep are skipped until reprobe.
+    The storage is provided by VEML7700Array<N>. */
+class VEML7700ArrayBase
+{
+public:
+  /** Add a sensor on the chosen mux channel. Returns the sensor index, or 0xFF if the array is full */
+  uint8_t addSensor(uint8_t channel);
+  uint8_t getNumSensors() { return _numSensors; };
+
+  /** Begin all of the sensors and enable their configuration caches. Default to Wire */
+  bool begin(TwoWire &wirePort = Wire);
+  /** Begin all of the sensors using a custom transport. The mux select callback is still used */
+  bool begin(VEML7700Transport &transport);
+
+  /** Access an individual sensor. Call select first if you are going to talk to it directly. */
+  VEML7700 &sensor(uint8_t index) { return _sensors[index]; };
+  bool select(uint8_t index);
+
+  /** A sensor which fails begin or startSweep is marked as failed. The sweeps skip it (without
+      using I2C) until reprobe begins it again. reprobe returns the number of sensors recovered */
+  bool isFailed(uint8_t index) { return ((index < _numSensors) && _failed[index]); };
+  uint8_t reprobe();
+
+  /** Apply the same configuration to all sensors */
+  VEML7700_error_t applyConfiguration(const VEML7700_config_t &config);
+
+  /** Sweep the sensors */
+  VEML7700_error_t startSweep();
+  bool isSweepReady();
+  uint8_t readSweep(float *lux, VEML7700_error_t *errors = NULL);
+  uint8_t readSweep(uint32_t *milliLux, VEML7700_error_t *errors = NULL);
+  uint8_t sweep(float *lux, VEML7700_error_t *errors = NULL);
+
+protected:
+  VEML7700ArrayBase(VEML7700 *sensors, uint8_t *channels, uint8_t *order, bool *failed, uint8_t capacity,
+                    VEML7700_mux_select_t muxSelect, void *context);
+
+private:
+  VEML7700 *_sensors;
+  uint8_t *_channels; // The mux channel for each sensor (in index order)
+  uint8_t *_order; // The sensor indexes, sorted by channel
+  bool *_failed; // True if the sensor failed begin or startSweep (in index order)
+  TwoWire *_wirePort; // From begin, for reprobe
+  VEML7700Transport *_transport;
+  uint8_t _capacity;
+  uint8_t _numSensors;
+  VEML7700_mux_select_t _muxSelect;
+  void *_muxContext;
+  int16_t _selectedChannel; // -1 if unknown
+  bool _reverse; // Sweep direction. Alternating means the last channel does not need to be selected again.
+  bool _sweepStarted;
+
+  bool selectChannel(uint8_t channel);
+  bool beginSensors(TwoWire *wirePort, VEML7700Transport *transport);
+  bool beginSensor(uint8_t index); // Select the channel and begin the sensor. Updates _failed
+  uint8_t sweepIndex(uint8_t position); // The sensor index for position in the sweep
+  uint8_t readSweep(float *lux, uint32_t *milliLux, VEML7700_error_t *errors);
+};
+
+/** Storage for up to N VEML7700s behind I2C muxes. No heap is used. */
+template <uint8_t N>
+class VEML7700Array : public VEML7700ArrayBase
+{
+public:
+  VEML7700Array(VEML7700_mux_select_t muxSelect, void *context = NULL)
+    : VEML7700ArrayBase(_sensorStorage, _channelStorage, _orderStorage, _failedStorage, N, muxSelect, context) {}
+
+private:
+  VEML7700 _sensorStorage[N];
+  uint8_t _channelStorage[N];
+  uint8_t _orderStorage[N];
+  bool _failedStorage[N];
+};
+
+/** A compact sample: the ALS count, the gain and integration time, and the time since the previous sample */
+typedef struct
+{
+  uint16_t ambient;
+  uint8_t range; // sensitivityMode * VEML7700_INTEGRATION_INVALID + integrationTime
+  uint8_t delta; // Time since the previous sample, in units of VEML7700_SAMPLE_TICK_ms
+} VEML7700_sample_t;
+
+/** The timestamp resolution of VEML7700_sample_t. The largest delta is 255 ticks (6.375s).
+    A longer gap is stored as an extra gap record in front of the sample, so the timestamps stay
+    exact (up to a gap of about 116 hours). Gap records use a slot, but are never drained. */
+#define VEML7700_SAMPLE_TICK_ms 25
+
+/** A fixed-capacity ring buffer of compact samples, 4 bytes per sample.
+    When the buffer is full, the oldest sample is overwritten.
+    Fill it with push, or attach it to a VEML7700 with setSampleBuffer so each poll reading is stored.
+    drain converts a batch into lux (oldest first), with optional millis() timestamps.
+    The storage is provided by VEML7700SampleBuffer<N>. */
+class VEML7700SampleBufferBase
+{
+public:
+  void push(uint16_t ambient, VEML7700_sensitivity_mode_t sm, VEML7700_integration_time_t it);
+  void push(uint16_t ambient, VEML7700_sensitivity_mode_t sm, VEML7700_integration_time_t it, unsigned long now);
+
+  uint16_t available() { return (_count - _gaps); };
+  uint16_t capacity() { return _capacity; };
+  uint32_t getOverwriteCount() { return _overwrites; }; // Samples lost because the buffer was full
+  void clear();
+
+  /** Remove up to maxCount samples (oldest first). Returns the number removed.
+      timestamps (optional) is set to the millis() each sample was stored */
+  uint16_t drain(float *lux, uint16_t maxCount, unsigned long *timestamps = NULL);
+  uint16_t drain(uint32_t *milliLux, uint16_t maxCount, unsigned long *timestamps = NULL);
+  /** Remove up to maxCount raw samples (oldest first). Returns the number removed */
+  uint16_t drain(VEML7700_sample_t *samples, uint16_t maxCount, unsigned long *timestamps = NULL);
+
+protected:
+  VEML7700SampleBufferBase(VEML7700_sample_t *samples, uint16_t capacity);
+
+private:
+  VEML7700_sample_t *_samples;
+  uint16_t _capacity;
+  uint16_t _head; // The oldest sample
+  uint16_t _count; // Including the gap records
+  uint16_t _gaps; // Gap records
+  uint32_t _overwrites;
+  unsigned long _oldestMillis; // The timestamp of the oldest sample
+  unsigned long _newestMillis; // The timestamp of the newest sample (as recorded, in whole ticks)
+
+  void pop(unsigned long *timestamp); // Remove the oldest sample and any gap records after it, update _oldestMillis
+  void append(uint16_t ambient, uint8_t range, uint8_t delta);
+};
+
+/** Storage for up to N samples. No heap is used. */
+template <uint16_t N>
+class VEML7700SampleBuffer : public VEML7700SampleBufferBase
+{
+public:
+  VEML7700SampleBuffer() : VEML7700SampleBufferBase(_sampleStorage, N) {}
+
+private:
+  VEML7700_sample_t _sampleStorage[N];
+};
+
+/** Streaming statistics: O(1) per sample, no heap.
+    The samples are normalized to counts at the finest resolution (x2, 800ms: 0.0036 lux per count),
+    so readings taken with different gains and integration times can be combined.
+    Everything is held as normalized counts and only converted to lux when queried.
+    Add samples with add, or attach it to a VEML7700 with setStatistics so each poll reading is added. */
+class VEML7700Statistics
+{
+public:
+  VEML7700Statistics();
+
+  void add(uint16_t ambient, VEML7700_sensitivity_mode_t sm, VEML7700_integration_time_t it);
+
+  /** Running mean, variance, min and max (Welford). Since the last reset.
+      The sum and the sum of squared differences are held in 64-bit integers, so they keep tracking
+      over long streams at the 25ms rate. The mean and variance stay exact (to float precision) for
+      2^32 - 1 samples, about 3.4 years at 40Hz. After that the count stops and they are frozen
+      until reset: the min, max, EMA and decimator keep going. */
+  void reset();
+  uint32_t getCount() { return _count; };
+  float getMeanLux();
+  float getVarianceLux(); // The sample variance (lux^2)
+  float getStdDevLux();
+  float getMinLux();
+  float getMaxLux();
+
+  /** Exponential moving average. Each sample moves the average 1/(2^shift) of the way. shift is 0 to 6 */
+  void setEMAShift(uint8_t shift);
+  float getEMALux();
+
+  /** Boxcar decimator: the mean of each block of factor samples (1 to 128) */
+  void setDecimation(uint8_t factor);
+  bool isDecimatedReady() { return _decimatedReady; };
+  /** Returns VEML7700_ERROR_NOT_READY if no new block has completed since the last call */
+  VEML7700_error_t getDecimatedLux(float *lux);
+
+protected:
+  uint32_t _count;
+  uint64_t _sum; // Normalized counts. Exact
+  uint64_t _m2; // Sum of the squared differences from the mean (normalized counts^2). Q4, scaled by 2^-_m2Shift
+  uint8_t _m2Shift; // Increased (and _m2 halved) instead of overflowing
+  uint32_t _min;
+  uint32_t _max;
+
+  uint8_t _emaShift;
+  bool _emaStarted;
+  uint32_t _emaSum; // The EMA * 2^_emaShift
+
+  uint8_t _decimation;
+  uint8_t _blockCount;
+  uint32_t _blockSum;
+  uint32_t _decimated; // The mean of the last complete block
+  bool _decimatedReady;
+};
+
+/** Flicker analysis of a burst of raw ALS counts. No heap: the samples stay in the caller's buffer.
+    A Goertzel filter per frequency costs one multiply-add per sample, far less than an FFT.
+    The sensor cannot sample fast enough to see 50 - 120Hz directly: each frequency is looked for
+    at the frequency it aliases to. Each sample is also the mean over the integration time, which
+    attenuates the flicker. This is corrected for, but a frequency the integration time averages
+    away (e.g. 120Hz with 25ms) cannot be measured. Check isObservable before using the depth. */
+class VEML7700Flicker
+{
+public:
+  VEML7700Flicker();
+
+  VEML7700_error_t analyze(const uint16_t *ambient, uint16_t count, unsigned long sampleMicros, unsigned long integrationMicros);
+
+  bool isObservable(VEML7700_flicker_frequency_t frequency);
+  /** The modulation depth: flicker amplitude / mean. Returns VEML7700_ERROR_UNDEFINED if not observable */
+  VEML7700_error_t getDepth(VEML7700_flicker_frequency_t frequency, float *depth);
+  float getDepth(VEML7700_flicker_frequency_t frequency);
+  float getAliasFrequency(VEML7700_flicker_frequency_t frequency);
+  float getMeanAmbient() { return _mean; };
+
+protected:
+  float _mean; // Counts
+  float _depth[VEML7700_FLICKER_INVALID];
+  float _alias[VEML7700_FLICKER_INVALID]; // Hz
+  uint8_t _observable; // Bit n is set if VEML7700_flicker_frequency_t n was observable
+};
+
+/** Ambient-adaptive sampling: the sampling interval follows how fast the light is changing.
+    Each sample is compared with the EMA of a statistics stage, with the sensor's calibration applied.
+    While the light is stable, the interval is lengthened one level at a time: the normal integration
+    time, then power saving modes 1 to 4, then shut down between samples with the sleep interval
+    doubling up to the maximum.
+    When the light changes fast, it drops straight back to the short (fast) integration time.
+    If auto-ranging is enabled, the auto-range sets the integration time and the scheduler only
+    changes the power saving mode and shut down.
+    Call service from loop (or after waking). Sleep until nextWakeMillis between calls. */
+class VEML7700AdaptiveScheduler
+{
+public:
+  VEML7700AdaptiveScheduler();
+
+  /** Takes over the sampling of sensor, and attaches statistics to it. Call after sensor.begin */
+  VEML7700_error_t begin(VEML7700 &sensor, VEML7700Statistics &statistics);
+
+  /** Take a sample if one is due. Returns VEML7700_ERROR_NOT_READY if not */
+  VEML7700_error_t service(float *lux);
+
+  /** The millis() at which service next needs to be called */
+  unsigned long nextWakeMillis();
+  unsigned long millisUntilWake();
+
+  /** The change of each sample from the EMA, as a fraction of the EMA. Below stableChange for
+      stableSamples samples in a row: lengthen the interval. Above fastChange: the fast level.
+      The defaults are 0.05, 0.25 and 4 */
+  void setChangeThresholds(float stableChange, float fastChange, uint8_t stableSamples = 4);
+  /** The integration times for the fast level and the others. The defaults are 25ms and 100ms */
+  VEML7700_error_t setIntegrationTimes(VEML7700_integration_time_t fast, VEML7700_integration_time_t normal);
+  /** The longest shut down interval. The default is 60s. The minimum is 8s */
+  void setMaxIntervalMillis(unsigned long maxMillis);
+
+  uint8_t getLevel() { return _level; };
+  bool isSleeping() { return _sleeping; };
+  /** The time between samples at the current level */
+  unsigned long getIntervalMillis();
+
+protected:
+  VEML7700 *_sensor;
+  VEML7700Statistics *_statistics;
+  float _stableChange;
+  float _fastChange;
+  uint8_t _stableSamples;
+  uint8_t _stableCount;
+  VEML7700_integration_time_t _fastIntegration;
+  VEML7700_integration_time_t _normalIntegration;
+  unsigned long _maxInterval;
+  uint8_t _level;
+  bool _started; // The statistics EMA has a sample
+  bool _sleeping; // The sensor is shut down until _wakeMillis
+  unsigned long _wakeMillis;
 
+  VEML7700_error_t applyLevel(uint8_t level, bool force);
+  unsigned long sleepIntervalMillis(uint8_t level);
 };
 
 #endif
\ No newline at end of file